@@ -1,4 +1,6 @@
+import ctypes
 import itertools
+import os
 import tkinter as tk
 from tkinter import messagebox, simpledialog, ttk
 import matplotlib.pyplot as plt
@@ -43,6 +45,41 @@ for x, y in [(1,1), (2,2), (3,3), (4,4)]:
 
 ROWS, COLS, LAYERS = 6, 6, 3
 
+# Native engine (librouter.so, built from RouterCAPI.cpp). The cost and via
+# arrays are handed to the library once and borrowed from then on, so they
+# must stay alive for as long as ROUTER is in use.
+SGR_ERR_CAPACITY = -2
+COST_BUF = np.ascontiguousarray(grid, dtype=np.int32)
+VIA_BUF = np.ascontiguousarray(has_via, dtype=np.uint8)
+
+def load_router():
+    here = os.path.dirname(os.path.abspath(__file__))
+    candidates = [os.environ.get("SGR_LIB"),
+                  os.path.join(here, "librouter.so"),
+                  os.path.join(here, "..", "librouter.so")]
+    for path in candidates:
+        if not path or not os.path.exists(path):
+            continue
+        lib = ctypes.CDLL(path)
+        i32p = ctypes.POINTER(ctypes.c_int32)
+        lib.sgr_create.restype = ctypes.c_void_p
+        lib.sgr_create.argtypes = [ctypes.c_int, ctypes.c_int, ctypes.c_int,
+                                   i32p, ctypes.POINTER(ctypes.c_uint8),
+                                   ctypes.c_int, ctypes.c_int]
+        lib.sgr_destroy.argtypes = [ctypes.c_void_p]
+        lib.sgr_route_best_order.restype = ctypes.c_int
+        lib.sgr_route_best_order.argtypes = [ctypes.c_void_p, i32p, ctypes.c_int, ctypes.c_int,
+                                             i32p, i32p, ctypes.c_int, i32p, i32p, i32p]
+        handle = lib.sgr_create(LAYERS, ROWS, COLS,
+                                COST_BUF.ctypes.data_as(i32p),
+                                VIA_BUF.ctypes.data_as(ctypes.POINTER(ctypes.c_uint8)),
+                                VIA_COST, 0)
+        if handle:
+            return lib, handle
+    return None, None
+
+LIB, ROUTER = load_router()
+
 def is_valid(x, y):
     return 0 <= x < ROWS and 0 <= y < COLS
 
@@ -105,7 +142,47 @@ def compute_cost(path):
             cost += VIA_COST
     return cost
 
+def route_nets_native(nets):
+    i32p = ctypes.POINTER(ctypes.c_int32)
+    n = len(nets)
+    packed = np.array([list(net["start"]) + list(net["end"]) for net in nets],
+                      dtype=np.int32).reshape(-1)
+    order = np.zeros(n, dtype=np.int32)
+    offsets = np.zeros(n + 1, dtype=np.int32)
+    costs = np.zeros(n, dtype=np.int32)
+    total = np.zeros(1, dtype=np.int32)
+
+    capacity = LAYERS * ROWS * COLS
+    while True:
+        cells = np.zeros(3 * capacity, dtype=np.int32)
+        routed = LIB.sgr_route_best_order(
+            ROUTER, packed.ctypes.data_as(i32p), n, 0,
+            order.ctypes.data_as(i32p), cells.ctypes.data_as(i32p), capacity,
+            offsets.ctypes.data_as(i32p), costs.ctypes.data_as(i32p),
+            total.ctypes.data_as(i32p))
+        if routed != SGR_ERR_CAPACITY:
+            break
+        capacity *= 2
+    if routed < 0:
+        raise ValueError(f"router error {routed}")
+
+    paths = []
+    for i in range(n):
+        if costs[i] < 0:
+            continue
+        flat = cells[3 * offsets[i]:3 * offsets[i + 1]].reshape(-1, 3)
+        paths.append((nets[order[i]]["name"], [tuple(int(v) for v in c) for c in flat]))
+    return {
+        "cost": int(total[0]),
+        "routed": routed,
+        "paths": paths,
+        "order": [nets[i]["name"] for i in order]
+    }
+
 def route_nets_permutation(nets):
+    if ROUTER:
+        return route_nets_native(nets)
+
     best_result = {
         "cost": INF,
         "routed": 0,
@@ -205,6 +282,8 @@ def main_gui():
     ttk.Label(frm, textvariable=status).grid(column=0, row=3, columnspan=4)
 
     root.mainloop()
+    if ROUTER:
+        LIB.sgr_destroy(ROUTER)
 
 if __name__ == "__main__":
     main_gui()
@@ -1,139 +1,21 @@
-#include <iostream>
-#include <vector>
-#include <queue>
-#include <climits>
-#include <tuple>
-#include <algorithm>
-#include <string>
+#include "RouterCore.h"
+#include "RouterConcurrent.h"
 
-using namespace std;
-
-const int INF = INT_MAX;
 const int VIA_COST = 20;
-const string SYMBOLS = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
-
-struct Node {
-    int x, y, layer, cost;
-    Node(int _x, int _y, int _layer, int _cost)
-        : x(_x), y(_y), layer(_layer), cost(_cost) {}
-    bool operator>(const Node& other) const {
-        return cost > other.cost;
-    }
-};
-
-struct Net {
-    string name;
-    tuple<int, int, int> start;
-    tuple<int, int, int> target;
-};
-
-bool isValid(int x, int y, int rows, int cols) {
-    return x >= 0 && y >= 0 && x < rows && y < cols;
-}
-
-vector<tuple<int, int, int>> dijkstra3D(
-    const vector<vector<vector<int>>>& grid,
-    const vector<vector<bool>>& hasVia,
-    const vector<vector<vector<bool>>>& blocked,
-    tuple<int, int, int> start,
-    tuple<int, int, int> target
-) {
-    int layers = grid.size(), rows = grid[0].size(), cols = grid[0][0].size();
-
-    vector<vector<vector<int>>> dist(layers, vector<vector<int>>(rows, vector<int>(cols, INF)));
-    vector<vector<vector<tuple<int, int, int>>>> parent(layers, vector<vector<tuple<int, int, int>>>(rows, vector<tuple<int, int, int>>(cols, {-1, -1, -1})));
-
-    auto [sx, sy, sl] = start;
-    auto [tx, ty, tl] = target;
-
-    if (blocked[sl][sx][sy] || blocked[tl][tx][ty])
-        return {};
-
-    dist[sl][sx][sy] = grid[sl][sx][sy];
-    priority_queue<Node, vector<Node>, greater<Node>> pq;
-    pq.push(Node(sx, sy, sl, grid[sl][sx][sy]));
-
-    vector<pair<int, int>> directions = {{0,1},{1,0},{-1,0},{0,-1}};
-
-    while (!pq.empty()) {
-        Node current = pq.top(); pq.pop();
-        int x = current.x, y = current.y, l = current.layer;
-
-        if (make_tuple(x, y, l) == target) break;
-
-        for (auto dir : directions) {
-            int nx = x + dir.first, ny = y + dir.second;
-            if (isValid(nx, ny, rows, cols) && !blocked[l][nx][ny]) {
-                int newCost = dist[l][x][y] + grid[l][nx][ny];
-                if (newCost < dist[l][nx][ny]) {
-                    dist[l][nx][ny] = newCost;
-                    parent[l][nx][ny] = {x, y, l};
-                    pq.push(Node(nx, ny, l, newCost));
-                }
-            }
-        }
-
-        // Via transitions (stacked vias: available at (x,y) across all layers)
-        if (hasVia[x][y]) {
-            if (l + 1 < layers && !blocked[l + 1][x][y]) {
-                int newCost = dist[l][x][y] + VIA_COST + grid[l + 1][x][y];
-                if (newCost < dist[l + 1][x][y]) {
-                    dist[l + 1][x][y] = newCost;
-                    parent[l + 1][x][y] = {x, y, l};
-                    pq.push(Node(x, y, l + 1, newCost));
-                }
-            }
-            if (l - 1 >= 0 && !blocked[l - 1][x][y]) {
-                int newCost = dist[l][x][y] + VIA_COST + grid[l - 1][x][y];
-                if (newCost < dist[l - 1][x][y]) {
-                    dist[l - 1][x][y] = newCost;
-                    parent[l - 1][x][y] = {x, y, l};
-                    pq.push(Node(x, y, l - 1, newCost));
-                }
-            }
-        }
-    }
 
-    vector<tuple<int, int, int>> path;
-    if (dist[tl][tx][ty] == INF) return {};
+using LayerRouter = Router<MultiLayer, StackedVias, NoTurnPenalty>;
 
-    tuple<int, int, int> p = target;
-    while (p != make_tuple(-1, -1, -1)) {
-        path.push_back(p);
-        p = parent[get<2>(p)][get<0>(p)][get<1>(p)];
-    }
-    reverse(path.begin(), path.end());
-    return path;
-}
-
-int computeTotalCost(const vector<tuple<int, int, int>>& path,
-                     const vector<vector<vector<int>>>& grid) {
-    int totalCost = 0;
-    for (size_t i = 0; i < path.size(); ++i) {
-        auto [x, y, l] = path[i];
-        totalCost += grid[l][x][y];
-        if (i > 0) {
-            auto [px, py, pl] = path[i - 1];
-            if (pl != l) totalCost += VIA_COST;
-        }
-    }
-    return totalCost;
-}
+int main(int argc, char* argv[]) {
+    int rows = 6, cols = 6, layers = 3;
 
-void printGridLayers(const vector<vector<vector<char>>>& layout, int layers) {
-    for (int l = 0; l < layers; ++l) {
-        cout << "\nLayer " << l << ":\n";
-        for (int i = 0; i < layout[0].size(); ++i) {
-            for (int j = 0; j < layout[0][0].size(); ++j) {
-                cout << layout[l][i][j] << " ";
-            }
-            cout << "\n";
-        }
+    // --threads N routes all nets concurrently on a shared occupancy map.
+    // --heatmap FILE writes per-cell search counters (see saveHeatmap).
+    int threads = 0;
+    string heatmapFile;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (string(argv[i]) == "--threads") threads = stoi(argv[i + 1]);
+        if (string(argv[i]) == "--heatmap") heatmapFile = argv[i + 1];
     }
-}
-
-int main() {
-    int rows = 6, cols = 6, layers = 3;
 
     vector<vector<vector<int>>> grid = {
         {
@@ -169,7 +51,12 @@ int main() {
     hasVia[3][3] = true;
     hasVia[4][4] = true;
 
-    vector<vector<vector<bool>>> blocked(layers, vector<vector<bool>>(rows, vector<bool>(cols, false)));
+    vector<int32_t> costs = flattenLayers(grid);
+    vector<uint8_t> viaFlags;
+    for (const auto& row : hasVia) viaFlags.insert(viaFlags.end(), row.begin(), row.end());
+    LayerRouter router{{layers, rows, cols, costs.data()}, {viaFlags.data(), cols, VIA_COST}, {}};
+
+    vector<uint8_t> blocked(router.grid.size(), 0);
     vector<vector<vector<char>>> layout(layers, vector<vector<char>>(rows, vector<char>(cols, '.')));
 
     int n;
@@ -198,24 +85,66 @@ int main() {
 
     int totalRoutingCost = 0;
 
+    SearchOptions options;
+    SearchHeat heat;
+    if (!heatmapFile.empty()) {
+        heat = SearchHeat(layers, rows, cols);
+        options.heat = &heat;
+    }
+    auto writeHeatmap = [&] {
+        if (!heatmapFile.empty() && !saveHeatmap(heatmapFile, heat, heatmapScale(rows, cols)))
+            cout << "Warning: could not write heatmap to " << heatmapFile << "\n";
+    };
+
+    if (threads > 0) {
+        OccupancyMap occupancy(router.grid.size());
+        ConcurrentStats stats;
+        auto result = routeConcurrent(router, nets, threads, occupancy, stats, options);
+
+        for (int i = 0; i < nets.size(); ++i) {
+            auto& net = nets[i];
+            char symbol = (i < SYMBOLS.size()) ? SYMBOLS[i] : '*';
+            if (result.paths[i].empty()) {
+                cout << "No path found for " << net.name << "!\n";
+                continue;
+            }
+            totalRoutingCost += result.costs[i];
+            cout << net.name << " routed with cost " << result.costs[i] << ":\n";
+            for (auto [x, y, l] : result.paths[i]) {
+                layout[l][x][y] = symbol;
+                cout << "(" << x << "," << y << ") [L" << l << "] -> ";
+            }
+            cout << "END\n";
+        }
+
+        cout << "\nConcurrent routing on " << threads << " threads: "
+             << stats.commits << " commits, " << stats.aborts << " aborts (abort rate "
+             << stats.abortRate() * 100 << "%), " << stats.searches << " searches, "
+             << stats.netsPerSecond() << " nets/s\n";
+        printGridLayers(layout, layers);
+        cout << "\n✅ Total Routing Cost across all nets: " << totalRoutingCost << endl;
+        writeHeatmap();
+        return 0;
+    }
+
     for (int i = 0; i < nets.size(); ++i) {
         auto& net = nets[i];
         char symbol = (i < SYMBOLS.size()) ? SYMBOLS[i] : '*';
         cout << "\nRouting " << net.name << "...\n";
 
-        auto path = dijkstra3D(grid, hasVia, blocked, net.start, net.target);
+        auto path = router.dijkstra3D(blocked.data(), net.start, net.target, options);
 
         if (path.empty()) {
             cout << "No path found for " << net.name << "!\n";
             continue;
         }
 
-        int cost = computeTotalCost(path, grid);
+        int cost = router.computeTotalCost(path);
         totalRoutingCost += cost;
 
         cout << net.name << " routed with cost " << cost << ":\n";
         for (auto [x, y, l] : path) {
-            blocked[l][x][y] = true;
+            blocked[router.grid.index(x, y, l)] = 1;
             layout[l][x][y] = symbol;
             cout << "(" << x << "," << y << ") [L" << l << "] -> ";
         }
@@ -225,6 +154,7 @@ int main() {
     printGridLayers(layout, layers);
 
     cout << "\n✅ Total Routing Cost across all nets: " << totalRoutingCost << endl;
+    writeHeatmap();
 
     return 0;
 }
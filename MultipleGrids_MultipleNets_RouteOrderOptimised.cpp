@@ -1,191 +1,121 @@
-#include <iostream>
-#include <vector>
-#include <queue>
-#include <climits>
-#include <tuple>
-#include <algorithm>
-#include <string>
+#include "RouterCore.h"
 #include <set>
 #include <chrono>
 #include <random>
 #include <iomanip>
+#include <csignal>
+#include <numeric>
 
-using namespace std;
-
-const int INF = INT_MAX;
 const int VIA_COST = 50;
 const int TURN_PENALTY = 10;
-const string SYMBOLS = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
-
-struct Node {
-    int x, y, layer, cost;
-    Node(int _x, int _y, int _layer, int _cost)
-        : x(_x), y(_y), layer(_layer), cost(_cost) {}
-    bool operator>(const Node& other) const {
-        return cost > other.cost;
-    }
-};
-
-struct Net {
-    string name;
-    tuple<int, int, int> start;
-    tuple<int, int, int> target;
-};
 
+// Handles, not copies: the net is an index into the net list and the path
+// lives in the arena of the order it was routed in.
 struct RoutedNetInfo {
-    Net net;
-    vector<tuple<int, int, int>> path;
+    int net;
+    PathRef path;
     int cost;
     char symbol;
 };
 
-struct DirNode {
-    int x, y, layer, cost;
-    int px, py, pl; // previous x,y,layer to compute direction change
-    DirNode(int _x, int _y, int _layer, int _cost, int _px, int _py, int _pl)
-        : x(_x), y(_y), layer(_layer), cost(_cost), px(_px), py(_py), pl(_pl) {}
-    bool operator>(const DirNode& other) const {
-        return cost > other.cost;
-    }
-};
-
-bool isValid(int x, int y, int rows, int cols) {
-    return x >= 0 && y >= 0 && x < rows && y < cols;
+using OrderRouter = Router<MultiLayer, StackedVias, TurnPenalty>;
+template <class T>
+using CompactOrderRouter = Router<MultiLayer, StackedVias, TurnPenalty, CompactGrid<T>>;
+
+// Ctrl-C ends the order search early; the best order found so far is kept.
+// A second Ctrl-C (e.g. while one long search is still running) kills the
+// program as usual.
+volatile sig_atomic_t interrupted = 0;
+void onInterrupt(int) {
+    interrupted = 1;
+    signal(SIGINT, SIG_DFL);
 }
 
-vector<tuple<int, int, int>> dijkstra3D(
-    const vector<vector<vector<int>>>& grid,
-    const vector<vector<bool>>& hasVia,
-    const vector<vector<vector<bool>>>& blocked,
-    tuple<int, int, int> start,
-    tuple<int, int, int> target
-) {
-    int layers = grid.size(), rows = grid[0].size(), cols = grid[0][0].size();
-
-    vector<vector<vector<int>>> dist(layers, vector<vector<int>>(rows, vector<int>(cols, INF)));
-    vector<vector<vector<tuple<int, int, int>>>> parent(layers, vector<vector<tuple<int, int, int>>>(rows, vector<tuple<int, int, int>>(cols, {-1, -1, -1})));
-
-    auto [sx, sy, sl] = start;
-    auto [tx, ty, tl] = target;
-
-    if (blocked[sl][sx][sy] || blocked[tl][tx][ty])
-        return {};
-
-    dist[sl][sx][sy] = grid[sl][sx][sy];
-    priority_queue<DirNode, vector<DirNode>, greater<DirNode>> pq;
-    pq.push(DirNode(sx, sy, sl, grid[sl][sx][sy], sx, sy, sl));
-
-    vector<pair<int, int>> directions = {{0,1},{1,0},{-1,0},{0,-1}};
-
-    while (!pq.empty()) {
-        DirNode current = pq.top(); pq.pop();
-        int x = current.x, y = current.y, l = current.layer;
-
-        if (make_tuple(x, y, l) == target) break;
-
-        for (auto [dx, dy] : directions) {
-            int nx = x + dx, ny = y + dy;
-            if (isValid(nx, ny, rows, cols) && !blocked[l][nx][ny]) {
-                int baseCost = dist[l][x][y] + grid[l][nx][ny];
-
-                // Check for turn
-                int prev_dx = x - current.px;
-                int prev_dy = y - current.py;
-                if (make_pair(dx, dy) != make_pair(prev_dx, prev_dy)) {
-                    baseCost += TURN_PENALTY;
-                }
-
-                if (baseCost < dist[l][nx][ny]) {
-                    dist[l][nx][ny] = baseCost;
-                    parent[l][nx][ny] = {x, y, l};
-                    pq.push(DirNode(nx, ny, l, baseCost, x, y, l));
-                }
-            }
-        }
-
-        // Via transitions
-        if (hasVia[x][y]) {
-            if (l + 1 < layers && !blocked[l + 1][x][y]) {
-                int newCost = dist[l][x][y] + VIA_COST + grid[l + 1][x][y];
-                if (newCost < dist[l + 1][x][y]) {
-                    dist[l + 1][x][y] = newCost;
-                    parent[l + 1][x][y] = {x, y, l};
-                    pq.push(DirNode(x, y, l + 1, newCost, x, y, l));
-                }
-            }
-            if (l - 1 >= 0 && !blocked[l - 1][x][y]) {
-                int newCost = dist[l][x][y] + VIA_COST + grid[l - 1][x][y];
-                if (newCost < dist[l - 1][x][y]) {
-                    dist[l - 1][x][y] = newCost;
-                    parent[l - 1][x][y] = {x, y, l};
-                    pq.push(DirNode(x, y, l - 1, newCost, x, y, l));
-                }
-            }
-        }
-    }
-
-    vector<tuple<int, int, int>> path;
-    if (dist[tl][tx][ty] == INF) return {};
-
-    tuple<int, int, int> p = target;
-    while (p != make_tuple(-1, -1, -1)) {
-        path.push_back(p);
-        p = parent[get<2>(p)][get<0>(p)][get<1>(p)];
-    }
-    reverse(path.begin(), path.end());
-    return path;
-}
-
-int computeTotalCost(const vector<tuple<int, int, int>>& path,
-                     const vector<vector<vector<int>>>& grid) {
-    int totalCost = 0;
-    for (size_t i = 0; i < path.size(); ++i) {
-        auto [x, y, l] = path[i];
-        totalCost += grid[l][x][y];
-        if (i > 0) {
-            auto [px, py, pl] = path[i - 1];
-            if (pl != l) totalCost += VIA_COST;
-        }
-    }
-    return totalCost;
-}
+int main(int argc, char* argv[]) {
+    int rows = 10, cols = 10, layers = 7;
 
-void printGridLayers(const vector<vector<vector<char>>>& layout, int layers) {
-    for (int l = 0; l < layers; ++l) {
-        cout << "\nLayer " << l << ":\n";
-        for (int i = 0; i < layout[0].size(); ++i) {
-            for (int j = 0; j < layout[0][0].size(); ++j) {
-                cout << layout[l][i][j] << " ";
-            }
-            cout << "\n";
-        }
+    // Optional: --seed N fixes the floorplan so repeated runs see the same
+    // grid, --exact-turns searches (cell, incoming direction) states, so each
+    // net gets the route that is optimal including its turn penalties,
+    // --landmarks FILE adds ALT lower bounds cached in FILE to that search and
+    // --cost-bits 8|16 searches over compact (quantised, tiled) cell costs.
+    //
+    // Anytime mode: --time-limit SEC and --max-expansions N bound the whole
+    // order search, --net-expansions N gives up on a single net after N
+    // expansions and --snapshot SEC prints the best order so far at that
+    // interval. The budget (and Ctrl-C) is checked before every net's search;
+    // the search reports the best complete order, or, if the budget runs out
+    // during the first order, that order with its remaining nets unrouted.
+    //
+    // --directions HV gives each layer a preferred direction (H, V or - for
+    // none, the pattern repeating over the layers); wrong-way moves are
+    // forbidden unless --wrong-way COST allows them at that extra cost.
+    //
+    // --heatmap FILE records per-cell expansions, overflow (cells wanted but
+    // held by another net) and rip-ups (routes of orders that were not kept)
+    // over the whole order search and writes them with saveHeatmap, summed
+    // over --heatmap-scale N cell bins (default: at most 1024 bins a side).
+    random_device rd;
+    unsigned seed = rd();
+    string landmarkFile;
+    int turnPenalty = TURN_PENALTY;
+    bool exactTurns = false;
+    int costBits = 32;
+    double timeLimit = 0, snapshotEvery = 0;
+    long long maxExpansions = 0, netExpansions = 0;
+    string directionPattern;
+    int wrongWayCost = WRONG_WAY_FORBIDDEN;
+    string heatmapFile;
+    int heatScale = 0;
+    for (int i = 1; i < argc; ++i) {
+        string flag = argv[i];
+        if (flag == "--seed" && i + 1 < argc) seed = stoul(argv[++i]);
+        else if (flag == "--landmarks" && i + 1 < argc) landmarkFile = argv[++i];
+        else if (flag == "--turn-penalty" && i + 1 < argc) turnPenalty = max(0, stoi(argv[++i]));
+        else if (flag == "--exact-turns") exactTurns = true;
+        else if (flag == "--cost-bits" && i + 1 < argc) costBits = stoi(argv[++i]);
+        else if (flag == "--time-limit" && i + 1 < argc) timeLimit = stod(argv[++i]);
+        else if (flag == "--max-expansions" && i + 1 < argc) maxExpansions = stoll(argv[++i]);
+        else if (flag == "--net-expansions" && i + 1 < argc) netExpansions = stoll(argv[++i]);
+        else if (flag == "--snapshot" && i + 1 < argc) snapshotEvery = stod(argv[++i]);
+        else if (flag == "--directions" && i + 1 < argc) directionPattern = argv[++i];
+        else if (flag == "--wrong-way" && i + 1 < argc) wrongWayCost = stoi(argv[++i]);
+        else if (flag == "--heatmap" && i + 1 < argc) heatmapFile = argv[++i];
+        else if (flag == "--heatmap-scale" && i + 1 < argc) heatScale = stoi(argv[++i]);
     }
-}
-
-
-int main() {
-    int rows = 10, cols = 10, layers = 7;
 
     // Seed with a real random value, if available
-    random_device rd;
-    mt19937 gen(rd());
+    mt19937 gen(seed);
     uniform_int_distribution<> dist(1, 5); // Random costs between 1 and 5
 
-    // Initialize the 3D grid
-    vector<vector<vector<int>>> grid(layers, vector<vector<int>>(rows, vector<int>(cols)));
+    // Initialize the 3D grid (flat, [layer][row][col])
+    vector<int32_t> costs((size_t)layers * rows * cols);
+    for (auto& c : costs) c = dist(gen);
 
-    for (int l = 0; l < layers; ++l) {
-        for (int r = 0; r < rows; ++r) {
-            for (int c = 0; c < cols; ++c) {
-                grid[l][r][c] = dist(gen);
-            }
-        }
+    vector<uint8_t> hasVia((size_t)rows * cols, 0);
+    for(int i=1;i<rows-1;i++){  
+        hasVia[i * cols + i]=1;
+        hasVia[(rows-1-i) * cols + i]=1;
     }
 
-    vector<vector<bool>> hasVia(rows, vector<bool>(cols, false));
-    for(int i=1;i<rows-1;i++){  
-        hasVia[i][i]=true;
-        hasVia[rows-1-i][i]=true;
+    OrderRouter router{{layers, rows, cols, costs.data()},
+                       {hasVia.data(), cols, VIA_COST},
+                       {turnPenalty}};
+    const RoutingGrid& grid = router.grid;
+
+    // Grid costs are fixed for the whole order search, so landmark tables are
+    // built once (or mapped from a previous run) and shared by every query.
+    LandmarkTables landmarks;
+    if (!landmarkFile.empty()) {
+        uint64_t gridHash = hashFloorplan(router);
+        if (loadLandmarks(landmarkFile, landmarks, router, gridHash)) {
+            cout << "Loaded " << landmarks.count << " landmark tables from " << landmarkFile << "\n";
+        } else {
+            buildLandmarks(router, landmarks);
+            if (!saveLandmarks(landmarkFile, landmarks, gridHash))
+                cout << "Warning: could not write landmark tables to " << landmarkFile << "\n";
+            cout << "Built " << landmarks.count << " landmark tables\n";
+        }
     }
 
     int n;
@@ -215,70 +145,201 @@ int main() {
         validNetCount++;
     }
 
-    struct RoutedNetInfo {
-        Net net;
-        vector<tuple<int, int, int>> path;
-        int cost;
-        char symbol;
-    };
+    // Obstacles / reserved regions: inclusive rectangles on one layer.
+    // Input that ends after the nets means no obstacles.
+    ObstacleMap obstacles(layers, rows, cols);
+    int m = 0;
+    cout << "Enter number of obstacles: ";
+    if (!(cin >> m)) m = 0;
+    for (int i = 0; i < m; ++i) {
+        int x1, y1, x2, y2, l;
+        cout << "Obstacle " << i + 1 << " (x1 y1 x2 y2 layer): ";
+        if (!(cin >> x1 >> y1 >> x2 >> y2 >> l)) break;
+        if (l < 0 || l >= layers) {
+            cout << "Invalid obstacle layer. Skipping...\n";
+            continue;
+        }
+        obstacles.add(l, {min(x1, x2), min(y1, y2), max(x1, x2), max(y1, y2)});
+    }
+
+    // Obstacles only appear in the printed layout; the search queries the index.
+    vector<vector<vector<char>>> baseLayout(layers, vector<vector<char>>(rows, vector<char>(cols, '.')));
+    for (int l = 0; l < layers; ++l)
+        for (const Rect& r : obstacles.rects[l])
+            for (int x = r.x1; x <= r.x2; ++x)
+                for (int y = r.y1; y <= r.y2; ++y)
+                    baseLayout[l][x][y] = '#';
+
+    SearchOptions options;
+    options.landmarks = landmarks.empty() ? nullptr : &landmarks;
+    options.exactTurns = exactTurns;
+    options.obstacles = &obstacles;
+    options.maxExpansions = netExpansions;
+
+    DirectionTable directionTable;
+    if (!directionPattern.empty()) {
+        vector<LayerRule> rules(layers);
+        for (int l = 0; l < layers; ++l) {
+            char d = toupper(directionPattern[l % directionPattern.size()]);
+            rules[l].preferred = d == 'H' ? LayerRule::HORIZONTAL
+                               : d == 'V' ? LayerRule::VERTICAL : LayerRule::ANY;
+            rules[l].wrongWayCost = wrongWayCost;
+        }
+        directionTable = compileDirections(rules, cols);
+        options.directions = &directionTable;
+    }
+
+    SearchHeat heat;
+    if (!heatmapFile.empty()) {
+        heat = SearchHeat(layers, rows, cols);
+        options.heat = &heat;
+    }
 
     vector<int> indices(nets.size());
     for (int i = 0; i < indices.size(); ++i) indices[i] = i;
 
     int bestRouted = -1;
     int minCost = INF;
-    vector<vector<vector<char>>> bestLayout;
-    vector<RoutedNetInfo> bestInfos;
 
-    do {
-        vector<vector<vector<bool>>> blocked(layers, vector<vector<bool>>(rows, vector<bool>(cols, false)));
-        vector<vector<vector<char>>> layout(layers, vector<vector<char>>(rows, vector<char>(cols, '.')));
+    // Paths of the order being tried go to trialArena, those of the best order
+    // so far stay in bestArena; the arenas swap when a trial wins. Search
+    // labels, the blockage grid and the info lists are reused for every order,
+    // so after the first order the loop no longer allocates.
+    Arena trialArena, bestArena;
+    SearchScratch scratch;
+    options.scratch = &scratch;
+    vector<uint8_t> blocked(grid.size());
+    vector<RoutedNetInfo> routedInfos, bestInfos;
+
+    // Budget: checked before each search, so a finished order is never
+    // thrown away. A later order cut short is discarded; the first one keeps
+    // the nets it routed and leaves the rest unrouted, so there is always a
+    // result to report.
+    auto begin = chrono::steady_clock::now();
+    auto elapsed = [&] { return chrono::duration<double>(chrono::steady_clock::now() - begin).count(); };
+    long long expansions = 0, ordersTried = 0, cappedSearches = 0;
+    double nextSnapshot = snapshotEvery;
+    bool outOfBudget = false;
+    size_t skippedNets = 0;   // first-order nets the budget left unrouted
+    signal(SIGINT, onInterrupt);
+
+    auto overBudget = [&] {
+        return interrupted || (timeLimit > 0 && elapsed() >= timeLimit) ||
+               (maxExpansions > 0 && expansions >= maxExpansions);
+    };
+
+    auto snapshot = [&] {
+        cout << "[" << fixed << setprecision(2) << elapsed() << "s] " << ordersTried
+             << " orders, " << expansions << " expansions, best: " << bestRouted
+             << " nets, cost " << minCost << ", order";
+        for (const auto& info : bestInfos) cout << " " << nets[info.net].name;
+        cout << "\n" << defaultfloat;
+    };
 
-        int totalRoutingCost = 0;
-        int routedNets = 0;
-        vector<RoutedNetInfo> routedInfos;
+    // One order search per engine; the compact engines route identically.
+    auto searchOrders = [&](const auto& engine) {
+        do {
+            // Routes of the previous order that lost (or of the best it
+            // replaced) are torn up here.
+            if (options.heat)
+                for (const auto& info : routedInfos) heat.rippedUp(info.path);
+            fill(blocked.begin(), blocked.end(), 0);
+            trialArena.reset();
+            routedInfos.clear();
+
+            int totalRoutingCost = 0;
+            int routedNets = 0;
+
+            for (int idx = 0; idx < indices.size(); ++idx) {
+                const Net& net = nets[indices[idx]];
+                char symbol = (idx < SYMBOLS.size()) ? SYMBOLS[idx] : '*';
+                if (overBudget()) {
+                    outOfBudget = true;
+                    if (ordersTried == 0) skippedNets = indices.size() - idx;
+                    break;
+                }
 
-        for (int idx = 0; idx < indices.size(); ++idx) {
-            Net net = nets[indices[idx]];
-            char symbol = (idx < SYMBOLS.size()) ? SYMBOLS[idx] : '*';
+                PathRef path = engine.dijkstra3D(trialArena, blocked.data(), net.start, net.target, options);
+                expansions += scratch.expanded;
+                cappedSearches += scratch.capped;
+                if (path.empty()) continue;
 
-            auto path = dijkstra3D(grid, hasVia, blocked, net.start, net.target);
-            if (path.empty()) continue;
+                int cost = engine.computeTotalCost(path);
+                totalRoutingCost += cost;
+                routedNets++;
 
-            int cost = computeTotalCost(path, grid);
-            totalRoutingCost += cost;
-            routedNets++;
+                for (auto [x, y, l] : path)
+                    blocked[grid.index(x, y, l)] = 1;
 
-            for (auto [x, y, l] : path) {
-                blocked[l][x][y] = true;
-                layout[l][x][y] = symbol;
+                routedInfos.push_back({indices[idx], path, cost, symbol});
+            }
+            if (outOfBudget && ordersTried > 0) break;
+            ordersTried++;
+
+            if (routedNets > bestRouted || (routedNets == bestRouted && totalRoutingCost < minCost)) {
+                bestRouted = routedNets;
+                minCost = totalRoutingCost;
+                swap(trialArena, bestArena);
+                swap(routedInfos, bestInfos);
             }
 
-            RoutedNetInfo info;
-            info.net = net;
-            info.path = path;
-            info.cost = cost;
-            info.symbol = symbol;
-            routedInfos.push_back(info);
-        }
+            if (outOfBudget) break;
 
-        if (routedNets > bestRouted || (routedNets == bestRouted && totalRoutingCost < minCost)) {
-            bestRouted = routedNets;
-            minCost = totalRoutingCost;
-            bestLayout = layout;
-            bestInfos = routedInfos;
-        }
+            if (snapshotEvery > 0 && elapsed() >= nextSnapshot) {
+                snapshot();
+                nextSnapshot = elapsed() + snapshotEvery;
+            }
+        } while (next_permutation(indices.begin(), indices.end()));
+    };
+
+    CompactOrderRouter<uint8_t> router8{{}, router.vias, router.turns};
+    CompactOrderRouter<uint16_t> router16{{}, router.vias, router.turns};
+    if (costBits == 8 && compactCosts(grid, router8.grid)) {
+        cout << "Using 8-bit cell costs (" << router8.grid.bytes() << " bytes)\n";
+        searchOrders(router8);
+    } else if (costBits == 16 && compactCosts(grid, router16.grid)) {
+        cout << "Using 16-bit cell costs (" << router16.grid.bytes() << " bytes)\n";
+        searchOrders(router16);
+    } else {
+        if (costBits != 32) cout << "Warning: costs do not fit in " << costBits << " bits, using 32\n";
+        searchOrders(router);
+    }
+    signal(SIGINT, SIG_DFL);
+    if (options.heat)
+        for (const auto& info : routedInfos) heat.rippedUp(info.path);
+
+    if (skippedNets > 0)
+        cout << "Budget exhausted during the first order (" << expansions << " expansions); "
+             << skippedNets << " nets were not searched and are left unrouted.\n";
+    else if (outOfBudget)
+        cout << "Budget exhausted after " << ordersTried << " complete orders (" << expansions
+             << " expansions); reporting the best so far.\n";
+    if (cappedSearches > 0)
+        cout << cappedSearches << " net searches hit the expansion cap and were left unrouted.\n";
+    if (!heatmapFile.empty()) {
+        int scale = heatScale > 0 ? heatScale : heatmapScale(rows, cols);
+        if (saveHeatmap(heatmapFile, heat, scale))
+            cout << "Heatmap written to " << heatmapFile << " (" << scale << "x" << scale << " bins): "
+                 << accumulate(heat.expansions.begin(), heat.expansions.end(), 0LL) << " expansions, "
+                 << accumulate(heat.overflow.begin(), heat.overflow.end(), 0LL) << " overflow, "
+                 << accumulate(heat.ripups.begin(), heat.ripups.end(), 0LL) << " rip-ups\n";
+        else
+            cout << "Warning: could not write heatmap to " << heatmapFile << "\n";
+    }
 
-    } while (next_permutation(indices.begin(), indices.end()));
+    vector<vector<vector<char>>> bestLayout = baseLayout;
+    for (const auto& info : bestInfos)
+        for (auto [x, y, l] : info.path)
+            bestLayout[l][x][y] = info.symbol;
 
     cout << "Best order of routing:\n";
     for (const auto& info : bestInfos) {
-        cout << info.net.name << " ";
+        cout << nets[info.net].name << " ";
     }
     cout << "\n";
     
         for (const auto& info : bestInfos) {
-        cout << info.net.name << " routed with cost " << info.cost << " using symbol '" << info.symbol << "':\n";
+        cout << nets[info.net].name << " routed with cost " << info.cost << " using symbol '" << info.symbol << "':\n";
         for (size_t i = 0; i < info.path.size(); ++i) {
             auto [x, y, l] = info.path[i];
             cout << "(" << x << "," << y << ") [L" << l << "]";
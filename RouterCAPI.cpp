@@ -0,0 +1,251 @@
+#include "RouterCAPI.h"
+#include "RouterCore.h"
+
+using TurnRouter = Router<MultiLayer, StackedVias, TurnPenalty>;
+using PlainRouter = Router<MultiLayer, StackedVias, NoTurnPenalty>;
+
+// A zero turn penalty selects the specialisation without direction logic.
+struct sgr_router {
+    TurnRouter turnRouter;
+    PlainRouter plainRouter;
+    const RoutingGrid& grid;
+    LandmarkTables landmarks;
+    ObstacleMap obstacles;
+    DirectionTable directions;   // empty = no layer direction rules
+    SourceTree fanout;           // last one-to-many tree, reused for the same source
+    bool fanoutValid = false;
+
+    sgr_router(const RoutingGrid& _grid, const StackedVias& vias, int turnPenalty)
+        : turnRouter{_grid, vias, {turnPenalty}}, plainRouter{_grid, vias, {}},
+          grid(turnRouter.grid), obstacles(_grid.layers, _grid.rows, _grid.cols) {}
+};
+
+namespace {
+
+struct OrderResult {
+    int routed = 0;
+    int totalCost = 0;
+    vector<vector<tuple<int, int, int>>> paths;   // empty = unroutable
+    vector<int> costs;
+};
+
+// Buffers shared by the orders of one call: search labels and the blockage
+// of the nets routed so far (cleared path by path after each order).
+struct OrderWorkspace {
+    SearchScratch scratch;
+    vector<uint8_t> blocked;
+};
+
+bool validCells(const sgr_router* router, const int32_t* cells, int n) {
+    const RoutingGrid& g = router->grid;
+    for (int i = 0; i < n; ++i) {
+        const int32_t* cell = cells + 3 * i;
+        if (!isValid(cell[0], cell[1], g.rows, g.cols) || cell[2] < 0 || cell[2] >= g.layers)
+            return false;
+    }
+    return true;
+}
+
+bool validNets(const sgr_router* router, const int32_t* nets, int n) {
+    return validCells(router, nets, 2 * n);
+}
+
+template <class R>
+OrderResult routeInOrder(const sgr_router* router, const R& engine, const int32_t* nets,
+                         const vector<int>& order, int flags, OrderWorkspace& work) {
+    const RoutingGrid& grid = router->grid;
+    SearchOptions options;
+    if ((flags & SGR_FLAG_LANDMARKS) && !router->landmarks.empty())
+        options.landmarks = &router->landmarks;
+    options.exactTurns = flags & SGR_FLAG_EXACT_TURNS;
+    options.obstacles = &router->obstacles;
+    if (!router->directions.moves.empty()) options.directions = &router->directions;
+    options.scratch = &work.scratch;
+
+    OrderResult result;
+    vector<uint8_t>& blocked = work.blocked;
+    blocked.resize(grid.size(), 0);
+    for (int idx : order) {
+        const int32_t* net = nets + 6 * idx;
+        auto path = engine.dijkstra3D(blocked.data(),
+                                      {net[0], net[1], net[2]}, {net[3], net[4], net[5]},
+                                      options);
+        int cost = -1;
+        if (!path.empty()) {
+            cost = engine.computeTotalCost(path);
+            result.routed++;
+            result.totalCost += cost;
+            for (auto [x, y, l] : path) blocked[grid.index(x, y, l)] = 1;
+        }
+        result.paths.push_back(move(path));
+        result.costs.push_back(cost);
+    }
+    for (const auto& path : result.paths)
+        for (auto [x, y, l] : path) blocked[grid.index(x, y, l)] = 0;
+    return result;
+}
+
+OrderResult routeInOrder(const sgr_router* router, const int32_t* nets,
+                         const vector<int>& order, int flags, OrderWorkspace& work) {
+    if (router->turnRouter.turns.penalty != 0)
+        return routeInOrder(router, router->turnRouter, nets, order, flags, work);
+    return routeInOrder(router, router->plainRouter, nets, order, flags, work);
+}
+
+template <class R>
+OrderResult routeFanout(sgr_router* router, const R& engine, const int32_t* source,
+                        const int32_t* targets, int n) {
+    tuple<int, int, int> start = {source[0], source[1], source[2]};
+    if (!router->fanoutValid || router->fanout.source != start) {
+        SearchOptions options;
+        options.obstacles = &router->obstacles;
+        if (!router->directions.moves.empty()) options.directions = &router->directions;
+        engine.plantTree(router->fanout, nullptr, start, options);
+        router->fanoutValid = true;
+    }
+
+    vector<tuple<int, int, int>> pins;
+    for (int i = 0; i < n; ++i)
+        pins.push_back({targets[3 * i], targets[3 * i + 1], targets[3 * i + 2]});
+
+    OrderResult result;
+    result.paths = engine.routeFanout(router->fanout, pins);
+    for (const auto& path : result.paths) {
+        int cost = path.empty() ? -1 : engine.computeTotalCost(path);
+        if (cost >= 0) {
+            result.routed++;
+            result.totalCost += cost;
+        }
+        result.costs.push_back(cost);
+    }
+    return result;
+}
+
+int writePaths(const OrderResult& result, int32_t* pathCells, int capacity,
+               int32_t* offsets, int32_t* costs) {
+    size_t needed = 0;
+    for (const auto& p : result.paths) needed += p.size();
+    if (needed > (size_t)capacity) return SGR_ERR_CAPACITY;
+
+    int32_t at = 0;
+    for (size_t i = 0; i < result.paths.size(); ++i) {
+        offsets[i] = at;
+        costs[i] = result.costs[i];
+        for (auto [x, y, l] : result.paths[i]) {
+            pathCells[3 * at] = x;
+            pathCells[3 * at + 1] = y;
+            pathCells[3 * at + 2] = l;
+            at++;
+        }
+    }
+    offsets[result.paths.size()] = at;
+    return result.routed;
+}
+
+}  // namespace
+
+extern "C" {
+
+sgr_router* sgr_create(int layers, int rows, int cols,
+                       const int32_t* cost, const uint8_t* via,
+                       int via_cost, int turn_penalty) {
+    if (layers <= 0 || rows <= 0 || cols <= 0 || !cost || !via) return nullptr;
+    return new sgr_router(RoutingGrid{layers, rows, cols, cost},
+                          StackedVias{via, cols, via_cost}, turn_penalty);
+}
+
+void sgr_destroy(sgr_router* router) {
+    delete router;
+}
+
+int sgr_build_landmarks(sgr_router* router, const char* path) {
+    if (!router) return SGR_ERR_ARGS;
+    const PlainRouter& engine = router->plainRouter;
+    uint64_t gridHash = hashFloorplan(engine);
+    if (path && loadLandmarks(path, router->landmarks, engine, gridHash))
+        return router->landmarks.count;
+
+    buildLandmarks(engine, router->landmarks);
+    if (path && !saveLandmarks(path, router->landmarks, gridHash)) return SGR_ERR_IO;
+    return router->landmarks.count;
+}
+
+int sgr_set_directions(sgr_router* router, const int32_t* preferred, int wrong_way_cost) {
+    if (!router || (wrong_way_cost < 0 && wrong_way_cost != SGR_WRONG_WAY_FORBIDDEN)) return SGR_ERR_ARGS;
+    router->fanoutValid = false;
+    if (!preferred) {
+        router->directions = DirectionTable();
+        return 0;
+    }
+    vector<LayerRule> rules(router->grid.layers);
+    for (int l = 0; l < router->grid.layers; ++l) {
+        if (preferred[l] < SGR_DIR_ANY || preferred[l] > SGR_DIR_VERTICAL) return SGR_ERR_ARGS;
+        rules[l].preferred = LayerRule::Direction(preferred[l]);
+        rules[l].wrongWayCost = wrong_way_cost;
+    }
+    router->directions = compileDirections(rules, router->grid.cols);
+    return 0;
+}
+
+int sgr_add_obstacle(sgr_router* router, int layer, int x1, int y1, int x2, int y2) {
+    if (!router || layer < 0 || layer >= router->grid.layers) return SGR_ERR_ARGS;
+    router->obstacles.add(layer, {min(x1, x2), min(y1, y2), max(x1, x2), max(y1, y2)});
+    router->fanoutValid = false;
+    return 0;
+}
+
+int sgr_route_nets(sgr_router* router, const int32_t* nets, int n, int flags,
+                   int32_t* path_cells, int capacity,
+                   int32_t* offsets, int32_t* costs) {
+    if (!router || n < 0 || (n > 0 && !nets) || !path_cells || capacity < 0 || !offsets || !costs ||
+        !validNets(router, nets, n))
+        return SGR_ERR_ARGS;
+
+    vector<int> order(n);
+    for (int i = 0; i < n; ++i) order[i] = i;
+    OrderWorkspace work;
+    return writePaths(routeInOrder(router, nets, order, flags, work), path_cells, capacity, offsets, costs);
+}
+
+int sgr_route_best_order(sgr_router* router, const int32_t* nets, int n, int flags,
+                         int32_t* order, int32_t* path_cells, int capacity,
+                         int32_t* offsets, int32_t* costs, int32_t* total_cost) {
+    if (!router || n < 0 || (n > 0 && !nets) || !order || !path_cells || capacity < 0 ||
+        !offsets || !costs || !validNets(router, nets, n))
+        return SGR_ERR_ARGS;
+
+    vector<int> indices(n);
+    for (int i = 0; i < n; ++i) indices[i] = i;
+
+    OrderResult best;
+    best.routed = -1;
+    vector<int> bestOrder;
+    OrderWorkspace work;
+    do {
+        OrderResult result = routeInOrder(router, nets, indices, flags, work);
+        if (result.routed > best.routed ||
+            (result.routed == best.routed && result.totalCost < best.totalCost)) {
+            best = move(result);
+            bestOrder = indices;
+        }
+    } while (next_permutation(indices.begin(), indices.end()));
+
+    for (int i = 0; i < n; ++i) order[i] = bestOrder[i];
+    if (total_cost) *total_cost = best.totalCost;
+    return writePaths(best, path_cells, capacity, offsets, costs);
+}
+
+int sgr_route_fanout(sgr_router* router, const int32_t* source, const int32_t* targets,
+                     int n, int flags, int32_t* path_cells, int capacity,
+                     int32_t* offsets, int32_t* costs) {
+    if (!router || !source || n < 0 || (n > 0 && !targets) || !path_cells || capacity < 0 ||
+        !offsets || !costs || !validCells(router, source, 1) || !validCells(router, targets, n))
+        return SGR_ERR_ARGS;
+
+    OrderResult result = router->turnRouter.turns.penalty != 0
+        ? routeFanout(router, router->turnRouter, source, targets, n)
+        : routeFanout(router, router->plainRouter, source, targets, n);
+    return writePaths(result, path_cells, capacity, offsets, costs);
+}
+
+}  // extern "C"
@@ -0,0 +1,100 @@
+#ifndef ROUTER_CAPI_H
+#define ROUTER_CAPI_H
+
+/*
+ * C interface to the routing engine in RouterCore.h, built as a shared
+ * library for the Python GUI (ctypes) and other non-C++ callers:
+ *
+ *   g++ -std=c++17 -O2 -shared -fPIC -o librouter.so RouterCAPI.cpp
+ *
+ * All buffers are flat and row-major. Cell costs are [layer][row][col],
+ * via flags are [row][col]. The router borrows the cost and via buffers
+ * passed to sgr_create (no copy), so they must stay alive and unchanged
+ * until sgr_destroy. Nets are packed as 6 ints each:
+ * sx sy sl tx ty tl. Paths come back packed as 3 ints per cell (x y layer).
+ *
+ * Functions returning int use negative values for errors (SGR_ERR_*).
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SGR_ERR_ARGS      (-1)   /* null handle/buffer, negative n/capacity or bad dimensions */
+#define SGR_ERR_CAPACITY  (-2)   /* output path buffer too small */
+#define SGR_ERR_IO        (-3)   /* landmark file could not be written */
+
+/* Search options for sgr_route_nets / sgr_route_best_order. */
+#define SGR_FLAG_LANDMARKS  2    /* use landmark bounds (see sgr_build_landmarks);
+                                    implies SGR_FLAG_EXACT_TURNS */
+#define SGR_FLAG_EXACT_TURNS 4   /* routes optimal including turn penalties
+                                    (labels per cell and incoming direction) */
+
+/* Preferred layer directions for sgr_set_directions. */
+#define SGR_DIR_ANY         0
+#define SGR_DIR_HORIZONTAL  1    /* along a row: y changes */
+#define SGR_DIR_VERTICAL    2    /* along a column: x changes */
+#define SGR_WRONG_WAY_FORBIDDEN  (-1)
+
+typedef struct sgr_router sgr_router;
+
+sgr_router* sgr_create(int layers, int rows, int cols,
+                       const int32_t* cost, const uint8_t* via,
+                       int via_cost, int turn_penalty);
+void sgr_destroy(sgr_router* router);
+
+/* Builds landmark tables, or maps them from path when it holds tables for
+ * the same floorplan. path may be NULL to keep them in memory only.
+ * Returns the number of landmarks. */
+int sgr_build_landmarks(sgr_router* router, const char* path);
+
+/* Sets one SGR_DIR_* per layer (preferred may be NULL to clear the rules).
+ * Wrong-way moves cost wrong_way_cost extra, or are not allowed when it is
+ * SGR_WRONG_WAY_FORBIDDEN. Applies to every later routing call. */
+int sgr_set_directions(sgr_router* router, const int32_t* preferred, int wrong_way_cost);
+
+/* Adds an inclusive rectangle obstacle on one layer. */
+int sgr_add_obstacle(sgr_router* router, int layer, int x1, int y1, int x2, int y2);
+
+/*
+ * Routes n nets in the given order, blocking each routed path for the nets
+ * after it. For net i, its cells are path_cells[offsets[i] .. offsets[i+1])
+ * (cell j at path_cells[3*j]) and costs[i] is its cost or -1 if unroutable.
+ * offsets must hold n+1 entries. Returns the number of nets routed, or
+ * SGR_ERR_CAPACITY if more than capacity cells are needed.
+ */
+int sgr_route_nets(sgr_router* router, const int32_t* nets, int n, int flags,
+                   int32_t* path_cells, int capacity,
+                   int32_t* offsets, int32_t* costs);
+
+/*
+ * Tries every net order (n! searches, so keep n small) and keeps the one
+ * that routes the most nets, then the cheapest. order receives the chosen
+ * permutation of net indices; offsets/costs/path_cells are as for
+ * sgr_route_nets but indexed by position in that order. *total_cost (may
+ * be NULL) receives the summed cost. Returns the number of nets routed.
+ */
+int sgr_route_best_order(sgr_router* router, const int32_t* nets, int n, int flags,
+                         int32_t* order, int32_t* path_cells, int capacity,
+                         int32_t* offsets, int32_t* costs, int32_t* total_cost);
+
+/*
+ * Routes from one source pin (3 ints: x y layer) to n target pins (packed
+ * the same way) with a single one-to-many search. The paths are branches of
+ * one tree and may share cells; nothing is blocked between them. Output is
+ * as for sgr_route_nets, one entry per target. The tree is kept, so another
+ * call with the same source continues it instead of searching again (until
+ * sgr_add_obstacle changes the floorplan). The tree is searched as with
+ * SGR_FLAG_EXACT_TURNS; SGR_FLAG_LANDMARKS is ignored.
+ */
+int sgr_route_fanout(sgr_router* router, const int32_t* source, const int32_t* targets,
+                     int n, int flags, int32_t* path_cells, int capacity,
+                     int32_t* offsets, int32_t* costs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,128 @@
+#pragma once
+
+// Concurrent net routing over one shared OccupancyMap (RouterCore.h).
+//
+// Workers search against the live occupancy bitmap without locks and only
+// synchronise at commit time: each path cell is claimed with
+// compare-and-swap, and if any cell was taken in the meantime the partial
+// claim is rolled back and the net is searched again against the updated
+// map. Nets are handed out by a lock-free work-stealing scheme: every worker
+// owns a slice of the net list with an atomic cursor and, once its slice is
+// drained, advances the cursors of the other slices.
+//
+// Results depend on thread timing (which net commits first), just as the
+// sequential routers depend on net order.
+//
+// With options.heat set, every worker counts into its own SearchHeat (merged
+// into options.heat at the end); a lost claim counts as overflow on the
+// contested cell and the rolled-back cells as rip-ups.
+
+#include "RouterCore.h"
+#include <thread>
+#include <chrono>
+
+const int MAX_COMMIT_RETRIES = 16;
+
+struct ConcurrentStats {
+    atomic<long long> searches{0};     // dijkstra3D calls
+    atomic<long long> commits{0};      // paths claimed successfully
+    atomic<long long> aborts{0};       // commits rolled back on a conflict
+    atomic<long long> unroutable{0};   // no path, or out of retries
+    double seconds = 0;
+
+    double abortRate() const {
+        long long attempts = commits + aborts;
+        return attempts ? (double)aborts / attempts : 0.0;
+    }
+    double netsPerSecond() const {
+        return seconds > 0 ? (commits + unroutable) / seconds : 0.0;
+    }
+};
+
+// One route per net, in net order; an empty path means the net failed.
+struct ConcurrentResult {
+    vector<vector<tuple<int, int, int>>> paths;
+    vector<int> costs;   // -1 when unrouted
+};
+
+template <class R>
+ConcurrentResult routeConcurrent(const R& router, const vector<Net>& nets, int threads,
+                                 OccupancyMap& occupancy, ConcurrentStats& stats,
+                                 SearchOptions options = SearchOptions()) {
+    int n = nets.size();
+    threads = max(1, min(threads, max(n, 1)));
+    options.occupancy = &occupancy;
+
+    ConcurrentResult result;
+    result.paths.resize(n);
+    result.costs.assign(n, -1);
+
+    struct alignas(64) Slice {
+        atomic<int> next;
+        int end;
+    };
+    vector<Slice> slices(threads);
+    for (int w = 0; w < threads; ++w) {
+        slices[w].next.store((long long)n * w / threads, memory_order_relaxed);
+        slices[w].end = (long long)n * (w + 1) / threads;
+    }
+
+    auto routeOne = [&](int i, const SearchOptions& workerOptions) {
+        const Net& net = nets[i];
+        for (int attempt = 0; attempt < MAX_COMMIT_RETRIES; ++attempt) {
+            auto path = router.dijkstra3D(nullptr, net.start, net.target, workerOptions);
+            stats.searches++;
+            if (path.empty()) break;
+
+            // Optimistic commit: claim every cell or none.
+            size_t claimed = 0;
+            for (; claimed < path.size(); ++claimed) {
+                auto [x, y, l] = path[claimed];
+                if (!occupancy.tryClaim(router.grid.index(x, y, l))) break;
+            }
+            if (claimed == path.size()) {
+                stats.commits++;
+                result.costs[i] = router.computeTotalCost(path);
+                result.paths[i] = move(path);
+                return;
+            }
+            SearchHeat* heat = workerOptions.heat;
+            for (size_t k = 0; k < claimed; ++k) {
+                auto [x, y, l] = path[k];
+                occupancy.release(router.grid.index(x, y, l));
+                if (heat) heat->ripups[router.grid.index(x, y, l)]++;
+            }
+            if (heat) {
+                auto [x, y, l] = path[claimed];
+                heat->overflow[router.grid.index(x, y, l)]++;
+            }
+            stats.aborts++;
+        }
+        stats.unroutable++;
+    };
+
+    vector<SearchHeat> heats;
+    if (options.heat)
+        heats.assign(threads, SearchHeat(options.heat->layers, options.heat->rows, options.heat->cols));
+    auto worker = [&](int w) {
+        SearchScratch scratch;
+        SearchOptions workerOptions = options;
+        workerOptions.scratch = &scratch;
+        workerOptions.heat = options.heat ? &heats[w] : nullptr;
+        for (int v = 0; v < threads; ++v) {
+            Slice& slice = slices[(w + v) % threads];   // own slice first, then steal
+            for (int i = slice.next.fetch_add(1); i < slice.end; i = slice.next.fetch_add(1))
+                routeOne(i, workerOptions);
+        }
+    };
+
+    auto begin = chrono::steady_clock::now();
+    vector<thread> pool;
+    for (int w = 1; w < threads; ++w) pool.emplace_back(worker, w);
+    worker(0);
+    for (auto& t : pool) t.join();
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    for (const SearchHeat& heat : heats) options.heat->merge(heat);
+
+    return result;
+}
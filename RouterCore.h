@@ -0,0 +1,1364 @@
+#pragma once
+
+// Header-only routing core shared by every front end and the C API
+// (RouterCAPI.h). The search is one template, Router<LayerPolicy, ViaPolicy,
+// TurnPolicy, CostGrid>, specialised at compile time:
+//
+//   LayerPolicy  SingleLayer | MultiLayer
+//   ViaPolicy    NoVias | StackedVias (both directions at a flagged (x, y))
+//                | UpwardVias (per-layer flag, layer l -> l + 1 only)
+//   TurnPolicy   NoTurnPenalty | TurnPenalty
+//   CostGrid     RoutingGrid (32-bit, default) | CompactGrid<uint8_t/uint16_t>
+//
+// Disabled features are `if constexpr`-ed out, so the 2D / no-via / no-turn
+// router carries no layer, via or direction logic. Landmark (ALT) bounds,
+// rectangle obstacles, per-layer preferred directions and search heatmaps
+// are optional per query.
+// Grids are flat [layer][row][col] buffers borrowed from the caller.
+
+#include <iostream>
+#include <vector>
+#include <queue>
+#include <climits>
+#include <tuple>
+#include <algorithm>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <type_traits>
+
+using namespace std;
+
+const int INF = INT_MAX;
+const string SYMBOLS = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+const int LANDMARK_COUNT = 8;      // landmark tables per floorplan
+const int ACTIVE_LANDMARKS = 4;    // of those, the ones a single query reads
+const int OBSTACLE_WINDOW_MARGIN = 8;
+const int DIRECTION_SLOTS = 5;     // per-cell states under turn penalties (Router::growStates)
+
+struct Node {
+    int x, y, layer, cost;
+    Node(int _x, int _y, int _layer, int _cost)
+        : x(_x), y(_y), layer(_layer), cost(_cost) {}
+    bool operator>(const Node& other) const {
+        return cost > other.cost;
+    }
+};
+
+struct Net {
+    string name;
+    tuple<int, int, int> start;
+    tuple<int, int, int> target;
+};
+
+inline bool isValid(int x, int y, int rows, int cols) {
+    return x >= 0 && y >= 0 && x < rows && y < cols;
+}
+
+// Path-cost addition that stops just below INF instead of wrapping, so huge
+// grids degrade to ties rather than negative distances.
+inline int addCost(int a, int b) {
+    long long sum = (long long)a + b;
+    return sum >= INF ? INF - 1 : (int)sum;
+}
+
+// Borrowed view of the cell costs, layers*rows*cols values.
+struct RoutingGrid {
+    int layers, rows, cols;
+    const int32_t* cost;
+
+    size_t index(int x, int y, int l) const {
+        return ((size_t)l * rows + x) * cols + y;
+    }
+    size_t size() const { return (size_t)layers * rows * cols; }
+    int at(int x, int y, int l) const { return cost[index(x, y, l)]; }
+};
+
+// Compact cell costs: 8- or 16-bit values, a single constant for a uniform
+// layer, and TILE x TILE tiles that collapse to one value when constant. A
+// layer where tiling saves nothing (few constant tiles, or a grid smaller
+// than a tile) is stored as a plain T array. This shrinks the cost grid a
+// resident router keeps (a quarter of the int32 size or less); it does not
+// make searches faster, since at() first reads the layer and tile tables.
+const int COST_TILE_SHIFT = 4;
+const int COST_TILE = 1 << COST_TILE_SHIFT;
+
+template <class T>
+struct CompactGrid {
+    int layers = 0, rows = 0, cols = 0;
+    int tileRows = 0, tileCols = 0;
+    vector<int32_t> layerCost;   // per layer: the constant, or -1 when tiled
+    vector<int32_t> layerTiles;  // per layer: first entry in tiles, or ~payload offset if untiled
+    vector<int32_t> tiles;       // ~value for a constant tile, else payload offset
+    vector<T> payload;           // COST_TILE * COST_TILE values per stored tile
+
+    size_t index(int x, int y, int l) const {
+        return ((size_t)l * rows + x) * cols + y;
+    }
+    size_t size() const { return (size_t)layers * rows * cols; }
+
+    int at(int x, int y, int l) const {
+        if (layerCost[l] >= 0) return layerCost[l];
+        if (layerTiles[l] < 0) return payload[(size_t)~layerTiles[l] + (size_t)x * cols + y];
+        int32_t t = tiles[layerTiles[l] + (x >> COST_TILE_SHIFT) * tileCols + (y >> COST_TILE_SHIFT)];
+        if (t < 0) return ~t;
+        return payload[(size_t)t + ((x & (COST_TILE - 1)) << COST_TILE_SHIFT) + (y & (COST_TILE - 1))];
+    }
+
+    size_t bytes() const {
+        return sizeof(int32_t) * (layerCost.size() + layerTiles.size() + tiles.size()) +
+               sizeof(T) * payload.size();
+    }
+};
+
+// Builds the compact form of src. Fails if a cost does not fit in T.
+template <class T>
+bool compactCosts(const RoutingGrid& src, CompactGrid<T>& out) {
+    for (size_t i = 0; i < src.size(); ++i)
+        if (src.cost[i] < 0 || src.cost[i] > numeric_limits<T>::max()) return false;
+
+    out.layers = src.layers; out.rows = src.rows; out.cols = src.cols;
+    out.tileRows = (src.rows + COST_TILE - 1) >> COST_TILE_SHIFT;
+    out.tileCols = (src.cols + COST_TILE - 1) >> COST_TILE_SHIFT;
+    out.layerCost.assign(src.layers, -1);
+    out.layerTiles.assign(src.layers, 0);
+    out.tiles.clear();
+    out.payload.clear();
+
+    for (int l = 0; l < src.layers; ++l) {
+        const int32_t* layer = src.cost + src.index(0, 0, l);
+        if (all_of(layer, layer + (size_t)src.rows * src.cols,
+                   [&](int32_t c) { return c == layer[0]; })) {
+            out.layerCost[l] = layer[0];
+            continue;
+        }
+        size_t tilesBefore = out.tiles.size(), payloadBefore = out.payload.size();
+        out.layerTiles[l] = out.tiles.size();
+        for (int tx = 0; tx < out.tileRows; ++tx) {
+            for (int ty = 0; ty < out.tileCols; ++ty) {
+                int x1 = tx << COST_TILE_SHIFT, y1 = ty << COST_TILE_SHIFT;
+                int x2 = min(x1 + COST_TILE, src.rows), y2 = min(y1 + COST_TILE, src.cols);
+                int first = src.at(x1, y1, l);
+                bool constant = true;
+                for (int x = x1; x < x2 && constant; ++x)
+                    for (int y = y1; y < y2 && constant; ++y)
+                        constant = src.at(x, y, l) == first;
+                if (constant) {
+                    out.tiles.push_back(~first);
+                    continue;
+                }
+                out.tiles.push_back(out.payload.size());
+                out.payload.resize(out.payload.size() + COST_TILE * COST_TILE, 0);
+                T* tile = &out.payload[out.payload.size() - COST_TILE * COST_TILE];
+                for (int x = x1; x < x2; ++x)
+                    for (int y = y1; y < y2; ++y)
+                        tile[((x - x1) << COST_TILE_SHIFT) + (y - y1)] = src.at(x, y, l);
+            }
+        }
+
+        size_t tiledBytes = sizeof(int32_t) * (out.tiles.size() - tilesBefore) +
+                            sizeof(T) * (out.payload.size() - payloadBefore);
+        if (tiledBytes >= sizeof(T) * src.rows * src.cols) {
+            out.tiles.resize(tilesBefore);
+            out.payload.resize(payloadBefore);
+            out.layerTiles[l] = ~(int32_t)payloadBefore;
+            out.payload.insert(out.payload.end(), layer, layer + (size_t)src.rows * src.cols);
+        }
+    }
+    return true;
+}
+
+// Nested [layer][row][col] costs (as typed into the front ends) -> flat buffer.
+inline vector<int32_t> flattenLayers(const vector<vector<vector<int>>>& grid) {
+    vector<int32_t> flat;
+    for (const auto& layer : grid)
+        for (const auto& row : layer)
+            flat.insert(flat.end(), row.begin(), row.end());
+    return flat;
+}
+
+inline void printGridLayers(const vector<vector<vector<char>>>& layout, int layers) {
+    for (int l = 0; l < layers; ++l) {
+        cout << "\nLayer " << l << ":\n";
+        for (size_t i = 0; i < layout[0].size(); ++i) {
+            for (size_t j = 0; j < layout[0][0].size(); ++j) {
+                cout << layout[l][i][j] << " ";
+            }
+            cout << "\n";
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Policies
+// ---------------------------------------------------------------------------
+
+struct SingleLayer {
+    static constexpr bool multiLayer = false;
+};
+
+struct MultiLayer {
+    static constexpr bool multiLayer = true;
+};
+
+struct NoVias {
+    static constexpr bool enabled = false;
+    static constexpr bool symmetric = true;
+    static constexpr int cost = 0;
+    bool up(int, int, int) const { return false; }
+    bool down(int, int, int) const { return false; }
+};
+
+// Stacked vias: a flag per (x, y) connects every pair of adjacent layers.
+struct StackedVias {
+    static constexpr bool enabled = true;
+    static constexpr bool symmetric = true;
+    const uint8_t* via;   // rows*cols flags
+    int cols;
+    int cost;
+    bool up(int x, int y, int) const { return via[(size_t)x * cols + y] != 0; }
+    bool down(int x, int y, int) const { return via[(size_t)x * cols + y] != 0; }
+};
+
+// Per-layer vias that only lead upwards: flag [x][y][l] joins l to l + 1.
+struct UpwardVias {
+    static constexpr bool enabled = true;
+    static constexpr bool symmetric = false;
+    const uint8_t* via;   // rows*cols*layers flags
+    int cols, layers;
+    int cost;
+    bool up(int x, int y, int l) const { return via[((size_t)x * cols + y) * layers + l] != 0; }
+    bool down(int, int, int) const { return false; }
+};
+
+struct NoTurnPenalty {
+    static constexpr bool enabled = false;
+    static constexpr int penalty = 0;
+};
+
+struct TurnPenalty {
+    static constexpr bool enabled = true;
+    int penalty;
+};
+
+// ---------------------------------------------------------------------------
+// Landmark (ALT) lower bounds
+//
+// A landmark table holds, for every cell, the cost of the cheapest path from
+// the landmark to that cell on the unblocked grid without turn penalties
+// (entry costs of every cell after the landmark plus the via cost per layer
+// change). Blocking cells and charging turns only ever makes paths dearer,
+// so the triangle-inequality bounds derived from these tables stay
+// admissible for every query on the same grid, and for every direction state
+// of a cell when the search charges turn penalties (Router::growStates).
+//
+// A floorplan gets LANDMARK_COUNT tables whatever its layer count, stored in
+// 16 bits as floor(d / scale) with one scale per table, and a query reads
+// only the ACTIVE_LANDMARKS tables that bound its own pins best. The bounds
+// are widened by scale - 1 to cover the rounding, so they stay admissible;
+// with scale > 1 they can be slightly inconsistent, which the search handles
+// by re-expanding a state whose label improves.
+// ---------------------------------------------------------------------------
+
+struct LandmarkHeader {
+    char magic[8];
+    int32_t layers, rows, cols, count;
+    uint64_t gridHash;
+};
+
+const char LANDMARK_MAGIC[8] = {'S', 'G', 'R', 'L', 'M', 'K', '0', '2'};
+const uint16_t LANDMARK_UNREACHED = UINT16_MAX;
+
+struct LandmarkTables {
+    int layers = 0, rows = 0, cols = 0, count = 0;
+    bool symmetric = true;                // reverse bounds valid (two-way vias)
+    vector<tuple<int, int, int>> cells;   // landmark positions (x, y, layer)
+    const int32_t* scale = nullptr;       // per table: stored value = floor(d / scale)
+    const uint16_t* dist = nullptr;       // count tables of layers*rows*cols
+    vector<int32_t> ownedScale;           // backing store when computed here
+    vector<uint16_t> owned;
+    void* mapped = nullptr;               // backing store when loaded from disk
+    size_t mappedSize = 0;
+
+    LandmarkTables() = default;
+    LandmarkTables(const LandmarkTables&) = delete;
+    LandmarkTables& operator=(const LandmarkTables&) = delete;
+    ~LandmarkTables() {
+        if (mapped) munmap(mapped, mappedSize);
+    }
+
+    bool empty() const { return count == 0; }
+
+    size_t index(int x, int y, int l) const {
+        return ((size_t)l * rows + x) * cols + y;
+    }
+
+    // Lower bound from landmark k on the cost still to pay from cell v to
+    // cell t (flat indices), costV/costT being their entry costs.
+    long long bound(int k, size_t v, size_t t, int costV, int costT) const {
+        const uint16_t* table = dist + (size_t)k * layers * rows * cols;
+        int dv = table[v], dt = table[t];
+        if (dv == LANDMARK_UNREACHED || dt == LANDMARK_UNREACHED) return 0;
+        long long q = scale[k];
+        // d(L,t) <= d(L,v) + d(v,t)
+        long long best = q * (dt - dv) - (q - 1);
+        // d(v,L) <= d(v,t) + d(t,L), with d(a,L) = d(L,a) - cost(a) + cost(L)
+        if (symmetric) best = max(best, q * (dv - dt) - (q - 1) - costV + costT);
+        return best;
+    }
+
+    // Fills active with the (at most ACTIVE_LANDMARKS) landmarks giving the
+    // largest bound from start to target; returns how many.
+    template <class Grid>
+    int selectActive(tuple<int, int, int> start, tuple<int, int, int> target,
+                     const Grid& grid, int* active) const {
+        auto [sx, sy, sl] = start;
+        auto [tx, ty, tl] = target;
+        size_t s = index(sx, sy, sl), t = index(tx, ty, tl);
+        int costS = grid.at(sx, sy, sl), costT = grid.at(tx, ty, tl);
+        long long best[ACTIVE_LANDMARKS];
+        int n = 0;
+        for (int k = 0; k < count; ++k) {
+            long long b = bound(k, s, t, costS, costT);
+            if (n == ACTIVE_LANDMARKS && b <= best[n - 1]) continue;
+            int i = n < ACTIVE_LANDMARKS ? n++ : n - 1;   // insertion, best first
+            for (; i > 0 && best[i - 1] < b; --i) {
+                best[i] = best[i - 1];
+                active[i] = active[i - 1];
+            }
+            best[i] = b;
+            active[i] = k;
+        }
+        return n;
+    }
+
+    // Lower bound on the cost still to pay from (x, y, l) to the target,
+    // from the given landmarks.
+    template <class Grid>
+    int lowerBound(const int* active, int n, int x, int y, int l,
+                   int tx, int ty, int tl, const Grid& grid) const {
+        size_t v = index(x, y, l), t = index(tx, ty, tl);
+        int costV = grid.at(x, y, l), costT = grid.at(tx, ty, tl);
+        long long best = 0;
+        for (int i = 0; i < n; ++i) best = max(best, bound(active[i], v, t, costV, costT));
+        return (int)min<long long>(best, INF - 1);
+    }
+};
+
+template <class R>
+uint64_t hashFloorplan(const R& router) {
+    const auto& grid = router.grid;
+    uint64_t h = 1469598103934665603ULL;
+    auto mix = [&h](uint64_t v) {
+        h ^= v;
+        h *= 1099511628211ULL;
+    };
+    mix(grid.layers); mix(grid.rows); mix(grid.cols); mix(router.vias.cost);
+    for (int l = 0; l < grid.layers; ++l)
+        for (int x = 0; x < grid.rows; ++x)
+            for (int y = 0; y < grid.cols; ++y)
+                mix((uint64_t)(uint32_t)grid.at(x, y, l));
+    for (int l = 0; l < grid.layers; ++l)
+        for (int x = 0; x < grid.rows; ++x)
+            for (int y = 0; y < grid.cols; ++y)
+                mix(router.vias.up(x, y, l) | router.vias.down(x, y, l) << 1);
+    return h;
+}
+
+// Full single-source search from a landmark over the unblocked grid.
+template <class R>
+void landmarkSearch(const R& router, tuple<int, int, int> source, int32_t* out) {
+    const auto& grid = router.grid;
+    int layers = grid.layers, rows = grid.rows, cols = grid.cols;
+    fill(out, out + grid.size(), INF);
+
+    auto [sx, sy, sl] = source;
+    out[grid.index(sx, sy, sl)] = 0;
+    priority_queue<Node, vector<Node>, greater<Node>> pq;
+    pq.push(Node(sx, sy, sl, 0));
+
+    vector<pair<int, int>> directions = {{0,1},{1,0},{-1,0},{0,-1}};
+
+    while (!pq.empty()) {
+        Node current = pq.top(); pq.pop();
+        int x = current.x, y = current.y, l = current.layer;
+        if (current.cost > out[grid.index(x, y, l)]) continue;
+
+        for (auto [dx, dy] : directions) {
+            int nx = x + dx, ny = y + dy;
+            if (!isValid(nx, ny, rows, cols)) continue;
+            int newCost = addCost(current.cost, grid.at(nx, ny, l));
+            if (newCost < out[grid.index(nx, ny, l)]) {
+                out[grid.index(nx, ny, l)] = newCost;
+                pq.push(Node(nx, ny, l, newCost));
+            }
+        }
+        for (int nl : {l + 1, l - 1}) {
+            if (nl < 0 || nl >= layers) continue;
+            if (nl > l ? !router.vias.up(x, y, l) : !router.vias.down(x, y, l)) continue;
+            int newCost = addCost(current.cost, router.vias.cost + grid.at(x, y, nl));
+            if (newCost < out[grid.index(x, y, nl)]) {
+                out[grid.index(x, y, nl)] = newCost;
+                pq.push(Node(x, y, nl, newCost));
+            }
+        }
+    }
+}
+
+// Picks LANDMARK_COUNT cells by farthest-point selection over the whole grid
+// (starting at the origin corner; a cell no chosen landmark reaches goes
+// first, so every connected part gets one) and runs one full search from
+// each, keeping the result in 16 bits.
+template <class R>
+void buildLandmarks(const R& router, LandmarkTables& lm) {
+    const auto& grid = router.grid;
+    int rows = grid.rows, cols = grid.cols, plane = rows * cols;
+    size_t cellsPerTable = grid.size();
+
+    lm.layers = grid.layers; lm.rows = rows; lm.cols = cols;
+    lm.count = (int)min<size_t>(LANDMARK_COUNT, cellsPerTable);
+    lm.symmetric = R::Vias::symmetric;
+    lm.cells.clear();
+    lm.ownedScale.clear();
+    lm.owned.assign(cellsPerTable * lm.count, LANDMARK_UNREACHED);
+
+    vector<int32_t> table(cellsPerTable), nearest(cellsPerTable, INF);
+    size_t next = 0;
+    for (int k = 0; k < lm.count; ++k) {
+        tuple<int, int, int> cell = {(int)(next % plane / cols), (int)(next % cols), (int)(next / plane)};
+        lm.cells.push_back(cell);
+        landmarkSearch(router, cell, table.data());
+
+        // Smallest scale that keeps the longest finite distance below
+        // LANDMARK_UNREACHED.
+        const long long top = LANDMARK_UNREACHED - 1;
+        long long longest = 0;
+        for (int32_t d : table)
+            if (d != INF) longest = max<long long>(longest, d);
+        int32_t scale = (int32_t)max<long long>(1, (longest + top - 1) / top);
+        lm.ownedScale.push_back(scale);
+        uint16_t* stored = lm.owned.data() + cellsPerTable * k;
+        for (size_t i = 0; i < cellsPerTable; ++i)
+            if (table[i] != INF) stored[i] = (uint16_t)(table[i] / scale);
+
+        // Next landmark: the cell farthest from all chosen ones.
+        size_t unreached = cellsPerTable;
+        next = 0;
+        for (size_t i = 0; i < cellsPerTable; ++i) {
+            nearest[i] = min(nearest[i], table[i]);
+            if (nearest[i] == INF) {
+                if (unreached == cellsPerTable) unreached = i;
+            } else if (nearest[i] > nearest[next]) {
+                next = i;
+            }
+        }
+        if (unreached != cellsPerTable) next = unreached;
+    }
+    lm.scale = lm.ownedScale.data();
+    lm.dist = lm.owned.data();
+}
+
+// File: header, count landmark cells (x, y, layer as int32), count int32
+// scales, then the uint16 tables.
+inline bool saveLandmarks(const string& path, const LandmarkTables& lm, uint64_t gridHash) {
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out) return false;
+
+    LandmarkHeader header;
+    memcpy(header.magic, LANDMARK_MAGIC, sizeof(header.magic));
+    header.layers = lm.layers; header.rows = lm.rows; header.cols = lm.cols;
+    header.count = lm.count;
+    header.gridHash = gridHash;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    for (auto [x, y, l] : lm.cells) {
+        int32_t cell[3] = {x, y, l};
+        out.write(reinterpret_cast<const char*>(cell), sizeof(cell));
+    }
+    out.write(reinterpret_cast<const char*>(lm.scale), sizeof(int32_t) * lm.count);
+    out.write(reinterpret_cast<const char*>(lm.dist),
+              sizeof(uint16_t) * (size_t)lm.count * lm.layers * lm.rows * lm.cols);
+    return (bool)out;
+}
+
+// Maps a previously saved table file read-only. Fails (leaving lm empty) if
+// the file is missing, truncated, in an older format or was built for a
+// different floorplan.
+template <class R>
+bool loadLandmarks(const string& path, LandmarkTables& lm, const R& router, uint64_t gridHash) {
+    int layers = router.grid.layers, rows = router.grid.rows, cols = router.grid.cols;
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(LandmarkHeader)) {
+        close(fd);
+        return false;
+    }
+    void* base = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return false;
+
+    const LandmarkHeader* header = static_cast<const LandmarkHeader*>(base);
+    size_t cellsPerTable = (size_t)layers * rows * cols;
+    size_t expected = sizeof(LandmarkHeader) + sizeof(int32_t) * 4 * header->count
+                    + sizeof(uint16_t) * cellsPerTable * header->count;
+    if (memcmp(header->magic, LANDMARK_MAGIC, sizeof(header->magic)) != 0 ||
+        header->layers != layers || header->rows != rows || header->cols != cols ||
+        header->gridHash != gridHash || header->count <= 0 ||
+        (size_t)st.st_size != expected) {
+        munmap(base, st.st_size);
+        return false;
+    }
+
+    const int32_t* cells = reinterpret_cast<const int32_t*>(header + 1);
+    lm.layers = layers; lm.rows = rows; lm.cols = cols;
+    lm.count = header->count;
+    lm.symmetric = R::Vias::symmetric;
+    lm.cells.clear();
+    for (int k = 0; k < lm.count; ++k)
+        lm.cells.push_back({cells[3 * k], cells[3 * k + 1], cells[3 * k + 2]});
+    lm.scale = cells + 3 * lm.count;
+    lm.dist = reinterpret_cast<const uint16_t*>(lm.scale + lm.count);
+    lm.mapped = base;
+    lm.mappedSize = st.st_size;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Rectangle obstacles and reserved regions
+//
+// Macros and keep-outs are stored as rectangles per layer instead of being
+// stamped into the per-cell blockage grid. The index keeps, for every row of
+// every layer, the sorted and merged column intervals covered by rectangles,
+// so a point query is one binary search and memory grows with the rectangle
+// outlines rather than their area.
+// ---------------------------------------------------------------------------
+
+struct Rect {
+    int x1, y1, x2, y2;   // inclusive corners, x = row, y = column
+};
+
+struct ObstacleMap {
+    int layers = 0, rows = 0, cols = 0;
+    vector<vector<Rect>> rects;                              // per layer
+    vector<vector<vector<pair<int, int>>>> rowIntervals;     // [layer][row] -> [y1, y2]
+
+    ObstacleMap(int _layers, int _rows, int _cols)
+        : layers(_layers), rows(_rows), cols(_cols), rects(_layers),
+          rowIntervals(_layers, vector<vector<pair<int, int>>>(_rows)) {}
+
+    bool empty() const {
+        for (const auto& r : rects)
+            if (!r.empty()) return false;
+        return true;
+    }
+
+    // Clips the rectangle to the grid and adds it to the index.
+    void add(int layer, Rect r) {
+        r.x1 = max(r.x1, 0); r.y1 = max(r.y1, 0);
+        r.x2 = min(r.x2, rows - 1); r.y2 = min(r.y2, cols - 1);
+        if (r.x1 > r.x2 || r.y1 > r.y2) return;
+        rects[layer].push_back(r);
+
+        for (int x = r.x1; x <= r.x2; ++x) {
+            auto& row = rowIntervals[layer][x];
+            row.push_back({r.y1, r.y2});
+            sort(row.begin(), row.end());
+            vector<pair<int, int>> merged;
+            for (auto iv : row) {
+                if (!merged.empty() && iv.first <= merged.back().second + 1)
+                    merged.back().second = max(merged.back().second, iv.second);
+                else
+                    merged.push_back(iv);
+            }
+            row = merged;
+        }
+    }
+
+    bool covers(int x, int y, int l) const {
+        const auto& row = rowIntervals[l][x];
+        auto it = upper_bound(row.begin(), row.end(), make_pair(y, INT_MAX));
+        return it != row.begin() && prev(it)->second >= y;
+    }
+};
+
+// Shared occupancy for concurrent routing (RouterConcurrent.h): one bit per
+// cell, read without locks during search and claimed with compare-and-swap
+// when a worker commits its path.
+struct OccupancyMap {
+    vector<atomic<uint64_t>> words;
+
+    explicit OccupancyMap(size_t cells) : words((cells + 63) / 64) {
+        for (auto& w : words) w.store(0, memory_order_relaxed);
+    }
+
+    bool test(size_t i) const {
+        return words[i >> 6].load(memory_order_relaxed) >> (i & 63) & 1;
+    }
+
+    // Sets the bit unless another worker already holds the cell.
+    bool tryClaim(size_t i) {
+        uint64_t bit = 1ULL << (i & 63);
+        uint64_t word = words[i >> 6].load(memory_order_relaxed);
+        do {
+            if (word & bit) return false;
+        } while (!words[i >> 6].compare_exchange_weak(word, word | bit, memory_order_acq_rel,
+                                                      memory_order_relaxed));
+        return true;
+    }
+
+    void release(size_t i) {
+        words[i >> 6].fetch_and(~(1ULL << (i & 63)), memory_order_release);
+    }
+};
+
+// Blockage seen by one search: routed-net cells (blocked may be null when a
+// front end never blocks), cells claimed in a shared occupancy map, plus
+// obstacles. Obstacles are rasterised into a
+// small bitmap only inside the window around the net's pins (where nearly
+// all expansions happen); outside it the interval index answers. The bitmap
+// lives in a caller-owned buffer (the search's SearchScratch), so a warmed-up
+// search does not allocate it again.
+struct SearchBlockage {
+    int rows, cols;
+    const uint8_t* blocked;
+    const OccupancyMap* occupancy;
+    const ObstacleMap* obstacles;
+    int wx1 = 0, wy1 = 0, wx2 = -1, wy2 = -1;
+    const char* window = nullptr;   // [layer][x - wx1][y - wy1]
+
+    SearchBlockage(int _rows, int _cols, const uint8_t* _blocked, const OccupancyMap* _occupancy,
+                   const ObstacleMap* _obstacles,
+                   tuple<int, int, int> start, tuple<int, int, int> target, vector<char>& buffer)
+        : rows(_rows), cols(_cols), blocked(_blocked), occupancy(_occupancy), obstacles(_obstacles) {
+        if (!obstacles || obstacles->empty()) {
+            obstacles = nullptr;
+            return;
+        }
+        auto [sx, sy, sl] = start;
+        auto [tx, ty, tl] = target;
+        wx1 = max(min(sx, tx) - OBSTACLE_WINDOW_MARGIN, 0);
+        wy1 = max(min(sy, ty) - OBSTACLE_WINDOW_MARGIN, 0);
+        wx2 = min(max(sx, tx) + OBSTACLE_WINDOW_MARGIN, obstacles->rows - 1);
+        wy2 = min(max(sy, ty) + OBSTACLE_WINDOW_MARGIN, obstacles->cols - 1);
+
+        int h = wx2 - wx1 + 1, w = wy2 - wy1 + 1;
+        buffer.assign((size_t)obstacles->layers * h * w, 0);
+        window = buffer.data();
+        for (int l = 0; l < obstacles->layers; ++l) {
+            for (int x = wx1; x <= wx2; ++x) {
+                char* row = &buffer[((size_t)l * h + (x - wx1)) * w];
+                for (auto [y1, y2] : obstacles->rowIntervals[l][x]) {
+                    int a = max(y1, wy1), b = min(y2, wy2);
+                    for (int y = a; y <= b; ++y) row[y - wy1] = 1;
+                }
+            }
+        }
+    }
+
+    // Held by a routed net (as opposed to an obstacle).
+    bool taken(int l, int x, int y) const {
+        size_t cell = ((size_t)l * rows + x) * cols + y;
+        return (blocked && blocked[cell]) || (occupancy && occupancy->test(cell));
+    }
+
+    bool operator()(int l, int x, int y) const {
+        size_t cell = ((size_t)l * rows + x) * cols + y;
+        if (blocked && blocked[cell]) return true;
+        if (occupancy && occupancy->test(cell)) return true;
+        if (!obstacles) return false;
+        if (x >= wx1 && x <= wx2 && y >= wy1 && y <= wy2) {
+            int h = wx2 - wx1 + 1, w = wy2 - wy1 + 1;
+            return window[((size_t)l * h + (x - wx1)) * w + (y - wy1)];
+        }
+        return obstacles->covers(x, y, l);
+    }
+};
+
+// Queue entry: priority, label and the label it was reached from (flat cell
+// indices, or direction states in Router::growStates). In the cell search the
+// predecessor gives the incoming direction for turn penalties.
+struct QueueEntry {
+    int cost, cell, from;
+    bool operator>(const QueueEntry& other) const {
+        return cost > other.cost;
+    }
+};
+
+// How a label's cell was entered: an in-plane move (0-3, as in
+// DirectionTable::directionIndex), a via from the layer below or above, or
+// not at all (the source). The predecessor follows from the move, so a label
+// stores this code instead of a parent index.
+const int ENTRY_UP = 4, ENTRY_DOWN = 5, ENTRY_SOURCE = 6;
+
+// One label: the distance and a tag packing the search epoch (24 bits), the
+// predecessor's direction slot (growStates) and the entry move. Checking and
+// updating a label is a single 8-byte access.
+struct Label {
+    int32_t dist;
+    uint32_t tag;   // epoch << 8 | parent slot << 4 | entry move
+};
+
+// Labels and queue storage reused from one search to the next. A label is
+// valid only when its epoch matches the current one, so starting a search
+// costs nothing per cell and allocates nothing once warmed up.
+// One scratch per thread.
+struct SearchScratch {
+    vector<Label> labels;
+    uint32_t epoch = 0;
+    int slots = 1;            // labels per cell: 1, or DIRECTION_SLOTS for direction states
+    vector<QueueEntry> heap;
+    vector<char> window;      // obstacle bitmap of the current search (SearchBlockage)
+    long long expanded = 0;   // cells expanded by the last search
+    bool capped = false;      // last search hit SearchOptions::maxExpansions
+
+    void begin(size_t cells, int cellSlots) {
+        slots = cellSlots;
+        if (labels.size() < cells * slots) labels.resize(cells * slots, Label{0, 0});
+        if (++epoch == 1u << 24) {
+            for (Label& a : labels) a.tag = 0;
+            epoch = 1;
+        }
+        heap.clear();
+        expanded = 0;
+        capped = false;
+    }
+    int distance(int n) const {
+        const Label& a = labels[n];
+        return a.tag >> 8 == epoch ? a.dist : INF;
+    }
+    // Best label over the slots of a cell (the lowest slot on ties); at
+    // receives its index.
+    int cellDistance(int cell, int* at = nullptr) const {
+        int best = INF;
+        for (int s = 0; s < slots; ++s) {
+            int d = distance(cell * slots + s);
+            if (d < best) {
+                best = d;
+                if (at) *at = cell * slots + s;
+            }
+        }
+        return best;
+    }
+    int entry(int n) const { return labels[n].tag & 15; }
+    int parentSlot(int n) const { return labels[n].tag >> 4 & 15; }
+    void label(int n, int d, int entry, int parentSlot = 0) {
+        labels[n] = {d, epoch << 8 | (uint32_t)parentSlot << 4 | (uint32_t)entry};
+    }
+};
+
+// Preferred routing direction of a metal layer. HORIZONTAL layers run along
+// rows (y changes), VERTICAL ones along columns (x changes). A wrong-way move
+// costs wrongWayCost extra, or is not allowed at all.
+const int WRONG_WAY_FORBIDDEN = -1;
+
+struct LayerRule {
+    enum Direction { ANY, HORIZONTAL, VERTICAL } preferred = ANY;
+    int wrongWayCost = 0;   // extra per wrong-way move, or WRONG_WAY_FORBIDDEN
+};
+
+// In-plane move with its flat-index offset, extra cost and direction index.
+struct Move {
+    int dx, dy, offset, extra, dir;
+};
+
+// Layer rules compiled for one grid width: per layer, the moves the search
+// may take (forbidden ones are left out, so restricted layers expand two
+// neighbours instead of four).
+struct DirectionTable {
+    vector<Move> moves;      // moves of layer l are [first[l], first[l + 1])
+    vector<int> first;
+    vector<int8_t> allowed;  // [layer][dir], dir as in directionIndex
+
+    static int directionIndex(int dx, int dy) {
+        return dx == 0 ? (dy > 0 ? 0 : 3) : (dx > 0 ? 1 : 2);
+    }
+    bool allows(int l, int dx, int dy) const { return allowed[l * 4 + directionIndex(dx, dy)]; }
+    const Move* begin(int l) const { return moves.data() + first[l]; }
+    const Move* end(int l) const { return moves.data() + first[l + 1]; }
+};
+
+inline DirectionTable compileDirections(const vector<LayerRule>& rules, int cols) {
+    const int directions[4][2] = {{0,1},{1,0},{-1,0},{0,-1}};
+    DirectionTable table;
+    for (const LayerRule& rule : rules) {
+        table.first.push_back(table.moves.size());
+        for (const auto& dir : directions) {
+            int dx = dir[0], dy = dir[1];
+            bool wrongWay = (rule.preferred == LayerRule::HORIZONTAL && dx != 0) ||
+                            (rule.preferred == LayerRule::VERTICAL && dy != 0);
+            int extra = wrongWay ? rule.wrongWayCost : 0;
+            table.allowed.push_back(extra != WRONG_WAY_FORBIDDEN);
+            if (extra != WRONG_WAY_FORBIDDEN)
+                table.moves.push_back({dx, dy, dx * cols + dy, extra, DirectionTable::directionIndex(dx, dy)});
+        }
+    }
+    table.first.push_back(table.moves.size());
+    return table;
+}
+
+// ---------------------------------------------------------------------------
+// Search heatmaps
+//
+// Optional per-cell counters showing where routing effort goes: how often
+// the search expanded a cell, how often it wanted a cell another net already
+// holds (overflow, including lost commits in the concurrent router) and how
+// often a routed cell was torn up again (rip-up). saveHeatmap writes the counters summed over scale x scale bins.
+// ---------------------------------------------------------------------------
+
+struct SearchHeat {
+    int layers = 0, rows = 0, cols = 0;
+    vector<uint32_t> expansions, overflow, ripups;   // [layer][row][col]
+
+    SearchHeat() = default;
+    SearchHeat(int _layers, int _rows, int _cols)
+        : layers(_layers), rows(_rows), cols(_cols),
+          expansions((size_t)_layers * _rows * _cols), overflow(expansions.size()),
+          ripups(expansions.size()) {}
+
+    template <class Path>
+    void rippedUp(const Path& path) {
+        for (auto [x, y, l] : path) ripups[((size_t)l * rows + x) * cols + y]++;
+    }
+    void merge(const SearchHeat& other) {
+        for (size_t i = 0; i < expansions.size(); ++i) {
+            expansions[i] += other.expansions[i];
+            overflow[i] += other.overflow[i];
+            ripups[i] += other.ripups[i];
+        }
+    }
+};
+
+struct HeatmapHeader {
+    char magic[8];
+    int32_t layers, rows, cols;            // grid size
+    int32_t scale, binRows, binCols;       // each bin sums scale x scale cells
+    int32_t channels;                      // expansions, overflow, rip-ups
+};
+
+const char HEATMAP_MAGIC[8] = {'S', 'G', 'R', 'H', 'E', 'A', 'T', '1'};
+
+// Smallest bin size that keeps a layer within maxSide x maxSide bins.
+inline int heatmapScale(int rows, int cols, int maxSide = 1024) {
+    int larger = max(rows, cols);
+    return max(1, (larger + maxSide - 1) / maxSide);
+}
+
+// File: header, then per layer the three channels as binRows x binCols
+// uint32 sums (saturating), row-major.
+inline bool saveHeatmap(const string& path, const SearchHeat& heat, int scale) {
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out || scale < 1) return false;
+
+    HeatmapHeader header;
+    memcpy(header.magic, HEATMAP_MAGIC, sizeof(header.magic));
+    header.layers = heat.layers; header.rows = heat.rows; header.cols = heat.cols;
+    header.scale = scale;
+    header.binRows = (heat.rows + scale - 1) / scale;
+    header.binCols = (heat.cols + scale - 1) / scale;
+    header.channels = 3;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    vector<uint64_t> sums((size_t)header.binRows * header.binCols);
+    vector<uint32_t> bins(sums.size());
+    for (int l = 0; l < heat.layers; ++l) {
+        for (const vector<uint32_t>* channel : {&heat.expansions, &heat.overflow, &heat.ripups}) {
+            fill(sums.begin(), sums.end(), 0);
+            const uint32_t* cell = channel->data() + (size_t)l * heat.rows * heat.cols;
+            for (int x = 0; x < heat.rows; ++x)
+                for (int y = 0; y < heat.cols; ++y)
+                    sums[(size_t)(x / scale) * header.binCols + y / scale] += *cell++;
+            for (size_t i = 0; i < sums.size(); ++i)
+                bins[i] = (uint32_t)min<uint64_t>(sums[i], UINT32_MAX);
+            out.write(reinterpret_cast<const char*>(bins.data()), sizeof(uint32_t) * bins.size());
+        }
+    }
+    return (bool)out;
+}
+
+// Optional per-query accelerations.
+struct SearchOptions {
+    const LandmarkTables* landmarks = nullptr;   // A* bounds; implies exactTurns
+    bool exactTurns = false;            // search (cell, direction) states (Router::growStates)
+    const ObstacleMap* obstacles = nullptr;
+    const OccupancyMap* occupancy = nullptr;
+    SearchScratch* scratch = nullptr;   // reused labels; a fresh one per query if null
+    long long maxExpansions = 0;        // give up (as unroutable) after this many; 0 = no cap
+    const DirectionTable* directions = nullptr;   // layer direction rules; all four moves if null
+    SearchHeat* heat = nullptr;         // expansion / overflow counters; one per thread
+};
+
+// Monotonic bump allocator for routes and other per-iteration data. Nothing
+// is freed individually: reset() rewinds to the first block and keeps every
+// block for the next round, so a warmed-up arena never touches the heap.
+struct Arena {
+    static constexpr size_t BLOCK_BYTES = 64 * 1024;
+    vector<unique_ptr<char[]>> blocks;
+    vector<size_t> blockSizes;
+    size_t block = 0, used = 0;
+
+    template <class T>
+    T* alloc(size_t n) {
+        static_assert(is_trivially_destructible<T>::value, "arena objects are never destroyed");
+        size_t bytes = sizeof(T) * n;
+        for (;; ++block, used = 0) {
+            if (block == blocks.size()) {
+                blockSizes.push_back(max(BLOCK_BYTES, bytes + alignof(T)));
+                blocks.emplace_back(new char[blockSizes.back()]);
+            }
+            size_t at = (used + alignof(T) - 1) / alignof(T) * alignof(T);
+            if (at + bytes <= blockSizes[block]) {
+                used = at + bytes;
+                return reinterpret_cast<T*>(blocks[block].get() + at);
+            }
+        }
+    }
+
+    void reset() { block = 0; used = 0; }
+};
+
+// A path stored in an Arena; valid until that arena is reset.
+struct PathRef {
+    const tuple<int, int, int>* cells = nullptr;
+    size_t count = 0;
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const tuple<int, int, int>& operator[](size_t i) const { return cells[i]; }
+    const tuple<int, int, int>* begin() const { return cells; }
+    const tuple<int, int, int>* end() const { return cells + count; }
+};
+
+// A shortest-path tree from one source, grown on demand by
+// Router::routeFanout and kept between calls.
+struct SourceTree {
+    SearchScratch scratch;
+    tuple<int, int, int> source;
+    const uint8_t* blocked = nullptr;
+    SearchOptions options;
+};
+
+// ---------------------------------------------------------------------------
+// Router
+// ---------------------------------------------------------------------------
+
+template <class LayerPolicy, class ViaPolicy, class TurnPolicy, class CostGrid = RoutingGrid>
+struct Router {
+    using Vias = ViaPolicy;
+
+    CostGrid grid;
+    ViaPolicy vias;
+    TurnPolicy turns;
+
+    // blocked holds grid.size() flags (nonzero = taken by a routed net) or is
+    // null. Returns the path as (x, y, layer) cells, empty if unroutable.
+    vector<tuple<int, int, int>> dijkstra3D(
+        const uint8_t* blocked,
+        tuple<int, int, int> start,
+        tuple<int, int, int> target,
+        const SearchOptions& options = SearchOptions()
+    ) const {
+        SearchScratch local;
+        SearchScratch& scratch = options.scratch ? *options.scratch : local;
+        int sink = search(blocked, start, target, options, scratch);
+        if (sink < 0) return {};
+        vector<tuple<int, int, int>> path(pathLength(scratch, sink));
+        writePath(scratch, sink, path.data(), path.size());
+        return path;
+    }
+
+    // Same search with the path stored in arena (no per-path heap allocation).
+    PathRef dijkstra3D(
+        Arena& arena,
+        const uint8_t* blocked,
+        tuple<int, int, int> start,
+        tuple<int, int, int> target,
+        const SearchOptions& options = SearchOptions()
+    ) const {
+        SearchScratch local;
+        SearchScratch& scratch = options.scratch ? *options.scratch : local;
+        int sink = search(blocked, start, target, options, scratch);
+        if (sink < 0) return {};
+        PathRef path;
+        path.count = pathLength(scratch, sink);
+        auto* cells = arena.alloc<tuple<int, int, int>>(path.count);
+        writePath(scratch, sink, cells, path.count);
+        path.cells = cells;
+        return path;
+    }
+
+    // Label the label n was reached from, or -1 at the source. Labels are
+    // cells, or direction states of one (n / scratch.slots is the cell).
+    int parentOf(const SearchScratch& scratch, int n) const {
+        int entry = scratch.entry(n);
+        if (entry == ENTRY_SOURCE) return -1;
+        int plane = grid.rows * grid.cols;
+        const int offset[ENTRY_SOURCE] = {1, grid.cols, -grid.cols, -1, plane, -plane};
+        return (n / scratch.slots - offset[entry]) * scratch.slots + scratch.parentSlot(n);
+    }
+
+    size_t pathLength(const SearchScratch& scratch, int sink) const {
+        size_t n = 0;
+        for (int p = sink; p != -1; p = parentOf(scratch, p)) n++;
+        return n;
+    }
+
+    // Walks the parents back from sink, filling out from the end.
+    void writePath(const SearchScratch& scratch, int sink,
+                   tuple<int, int, int>* out, size_t n) const {
+        int plane = grid.rows * grid.cols, cols = grid.cols;
+        for (int p = sink; p != -1; p = parentOf(scratch, p)) {
+            int cell = p / scratch.slots;
+            out[--n] = {cell % plane / cols, cell % cols, cell / plane};
+        }
+    }
+
+    // One-to-many search. plantTree roots a shortest-path tree at start and
+    // routeFanout grows it just far enough to settle the given targets,
+    // returning one path per target (empty if unreachable). Later calls on
+    // the same tree continue the expansion instead of restarting, so k
+    // targets from one driver cost a single search. The paths are branches of
+    // one tree and may share cells; blocked and the options' blockage must
+    // stay unchanged while the tree is in use. The tree holds direction
+    // states (as with SearchOptions::exactTurns); landmark bounds are per
+    // target and are not used here.
+    void plantTree(SourceTree& tree, const uint8_t* blocked, tuple<int, int, int> start,
+                   const SearchOptions& options = SearchOptions()) const {
+        tree.source = start;
+        tree.blocked = blocked;
+        tree.options = options;
+        tree.options.landmarks = nullptr;
+        growStates(blocked, start, start, false, tree.options, tree.scratch, true,
+                   [](int) { return true; });
+    }
+
+    vector<vector<tuple<int, int, int>>> routeFanout(
+        SourceTree& tree, const vector<tuple<int, int, int>>& targets) const {
+        settleTargets(tree, targets);
+        vector<vector<tuple<int, int, int>>> paths;
+        for (auto target : targets) paths.push_back(treePath(tree, target));
+        return paths;
+    }
+
+    // Grows the tree until every target has its final label (or is known to
+    // be unreachable), without building paths; tree.scratch.distance() then
+    // gives the cost of each.
+    void settleTargets(SourceTree& tree, const vector<tuple<int, int, int>>& targets) const {
+        const SearchScratch& labels = tree.scratch;
+        vector<int> pending;
+        for (auto [x, y, l] : targets) pending.push_back(grid.index(x, y, l));
+
+        // Step costs are nonnegative, so nothing popped at cost > d can label
+        // a state at d or less: a target is final, with every state of its
+        // cell that ties its cost, once the frontier has passed it.
+        int scanned = -1;
+        auto settled = [&](int frontier) {
+            if (frontier == scanned) return false;
+            scanned = frontier;
+            pending.erase(remove_if(pending.begin(), pending.end(),
+                                    [&](int t) { return labels.cellDistance(t) < frontier; }),
+                          pending.end());
+            return pending.empty();
+        };
+        if (!pending.empty())
+            growStates(tree.blocked, tree.source, tree.source, false, tree.options, tree.scratch, false,
+                       settled);
+    }
+
+    // Branch of the tree from the source to cell; empty if it is unreached.
+    vector<tuple<int, int, int>> treePath(const SourceTree& tree, tuple<int, int, int> cell) const {
+        auto [x, y, l] = cell;
+        int sink = -1;
+        vector<tuple<int, int, int>> path;
+        if (tree.scratch.cellDistance(grid.index(x, y, l), &sink) != INF) {
+            path.resize(pathLength(tree.scratch, sink));
+            writePath(tree.scratch, sink, path.data(), path.size());
+        }
+        return path;
+    }
+
+    // Labels cells (or direction states) in scratch; returns the target's
+    // label index, or -1 if it cannot be reached.
+    int search(
+        const uint8_t* blocked,
+        tuple<int, int, int> start,
+        tuple<int, int, int> target,
+        const SearchOptions& options,
+        SearchScratch& scratch
+    ) const {
+        if (options.exactTurns || options.landmarks)
+            return growStates(blocked, start, target, true, options, scratch, true, [](int) { return false; });
+        return searchCells(blocked, start, target, options, scratch);
+    }
+
+    // The default search: one label per cell, as in the original dijkstra3D.
+    // A queue entry remembers the cell it was pushed from, and the turn
+    // penalty of each move is judged against that direction, with the
+    // cell's current label. Entries whose label has since improved are still
+    // expanded, so a cell may be expanded once per incoming direction. The
+    // search stops when the target comes off the queue; returns its flat
+    // index, or -1 if it cannot be reached.
+    int searchCells(
+        const uint8_t* blocked,
+        tuple<int, int, int> start,
+        tuple<int, int, int> target,
+        const SearchOptions& options,
+        SearchScratch& scratch
+    ) const {
+        constexpr bool multiLayer = LayerPolicy::multiLayer;
+        int layers = multiLayer ? grid.layers : 1, rows = grid.rows, cols = grid.cols;
+        int plane = rows * cols;
+
+        scratch.begin(grid.size(), 1);
+        auto dist = [&](int n) { return scratch.distance(n); };
+
+        auto [sx, sy, sl] = start;
+        auto [tx, ty, tl] = target;
+        int source = grid.index(sx, sy, sl), sink = grid.index(tx, ty, tl);
+
+        SearchBlockage isBlocked(rows, cols, blocked, options.occupancy, options.obstacles, start, target,
+                                 scratch.window);
+        if (isBlocked(sl, sx, sy) || isBlocked(tl, tx, ty)) return -1;
+
+        const DirectionTable* rules = options.directions;
+        SearchHeat* heat = options.heat;
+        vector<QueueEntry>& heap = scratch.heap;
+        auto push = [&](QueueEntry e) {
+            heap.push_back(e);
+            push_heap(heap.begin(), heap.end(), greater<QueueEntry>());
+        };
+        scratch.label(source, grid.at(sx, sy, sl), ENTRY_SOURCE);
+        push({dist(source), source, source});
+
+        const Move anyDirection[4] = {{0, 1, 1, 0, 0}, {1, 0, cols, 0, 1}, {-1, 0, -cols, 0, 2}, {0, -1, -1, 0, 3}};
+
+        while (!heap.empty()) {
+            pop_heap(heap.begin(), heap.end(), greater<QueueEntry>());
+            QueueEntry current = heap.back();
+            heap.pop_back();
+            int here = current.cell;
+            int l = multiLayer ? here / plane : 0;
+            int x = here % plane / cols, y = here % cols;
+
+            if (here == sink) return sink;
+            if (++scratch.expanded > options.maxExpansions && options.maxExpansions > 0) {
+                scratch.capped = true;
+                return -1;
+            }
+            if (heat) heat->expansions[here]++;
+
+            const Move* movesBegin = rules ? rules->begin(l) : anyDirection;
+            const Move* movesEnd = rules ? rules->end(l) : anyDirection + 4;
+            for (const Move* move = movesBegin; move != movesEnd; ++move) {
+                int nx = x + move->dx, ny = y + move->dy;
+                if (!isValid(nx, ny, rows, cols)) continue;
+                int next = here + move->offset;
+                if (isBlocked(l, nx, ny)) {
+                    if (heat && isBlocked.taken(l, nx, ny)) heat->overflow[next]++;
+                    continue;
+                }
+
+                int baseCost = addCost(dist(here), grid.at(nx, ny, l) + move->extra);
+                if constexpr (TurnPolicy::enabled) {
+                    // Check for turn
+                    if (next - here != here - current.from) baseCost = addCost(baseCost, turns.penalty);
+                }
+                if (baseCost < dist(next)) {
+                    scratch.label(next, baseCost, move->dir);
+                    push({baseCost, next, here});
+                }
+            }
+
+            // Via transitions
+            if constexpr (multiLayer && ViaPolicy::enabled) {
+                for (int nl : {l + 1, l - 1}) {
+                    if (nl < 0 || nl >= layers) continue;
+                    if (nl > l ? !vias.up(x, y, l) : !vias.down(x, y, l)) continue;
+                    int next = grid.index(x, y, nl);
+                    if (isBlocked(nl, x, y)) {
+                        if (heat && isBlocked.taken(nl, x, y)) heat->overflow[next]++;
+                        continue;
+                    }
+                    int newCost = addCost(dist(here), vias.cost + grid.at(x, y, nl));
+                    if (newCost < dist(next)) {
+                        scratch.label(next, newCost, nl > l ? ENTRY_UP : ENTRY_DOWN);
+                        push({newCost, next, here});
+                    }
+                }
+            }
+        }
+        return -1;
+    }
+
+    // Labels per cell under a turn penalty: slot 0-3 is the direction of the
+    // move into the cell (DirectionTable::directionIndex), slot 4 a via or
+    // the source, after which any in-plane move counts as a turn. Without a
+    // penalty the direction does not matter and a cell has one slot.
+    int directionSlots() const {
+        return TurnPolicy::enabled && turns.penalty != 0 ? DIRECTION_SLOTS : 1;
+    }
+
+    // The search over (cell, incoming direction) states. The turn penalty of
+    // a move depends only on the state it leaves, so the labels are exact:
+    // routes are optimal for cell costs + vias + wrong-way extras + turn
+    // penalties whatever the expansion order, which is what lets landmark
+    // bounds (A*) and fanout trees work under turn penalties.
+    // With singleTarget it returns the label index of the target's best
+    // state once the queue has passed its cost (so, as in a fanout tree,
+    // every state tying it is known), or -1. Otherwise it has no sink and
+    // stops when done(lowest queued cost) says so, keeping its frontier in
+    // scratch so a later call with fresh = false resumes it.
+    template <class Done>
+    int growStates(
+        const uint8_t* blocked,
+        tuple<int, int, int> start,
+        tuple<int, int, int> target,
+        bool singleTarget,
+        const SearchOptions& options,
+        SearchScratch& scratch,
+        bool fresh,
+        Done done
+    ) const {
+        constexpr bool multiLayer = LayerPolicy::multiLayer;
+        int layers = multiLayer ? grid.layers : 1, rows = grid.rows, cols = grid.cols;
+        int plane = rows * cols;
+        int slots = directionSlots();
+        const LandmarkTables* landmarks = singleTarget ? options.landmarks : nullptr;
+
+        if (fresh) scratch.begin(grid.size(), slots);
+        auto dist = [&](int n) { return scratch.distance(n); };
+
+        auto [sx, sy, sl] = start;
+        auto [tx, ty, tl] = target;
+        int source = grid.index(sx, sy, sl), sink = singleTarget ? grid.index(tx, ty, tl) : -1;
+
+        SearchBlockage isBlocked(rows, cols, blocked, options.occupancy, options.obstacles, start, target,
+                                 scratch.window);
+        if (fresh && (isBlocked(sl, sx, sy) || (singleTarget && isBlocked(tl, tx, ty))))
+            return -1;
+
+        // With landmark tables the queue is ordered by dist + lower bound (A*)
+        // over the landmarks that bound this pin pair best; without them the
+        // bound is zero and this is plain Dijkstra. The bounds ignore turns,
+        // so they hold for every state of a cell.
+        int active[ACTIVE_LANDMARKS];
+        int activeCount = landmarks ? landmarks->selectActive(start, target, grid, active) : 0;
+        auto bound = [&](int x, int y, int l) {
+            return landmarks ? landmarks->lowerBound(active, activeCount, x, y, l, tx, ty, tl, grid) : 0;
+        };
+
+        // A state that costs at least one turn penalty more than another
+        // state of its cell is dominated (from the cheaper one any move costs
+        // at most one turn more), so it is neither labelled nor expanded.
+        auto dominated = [&](int cell, int d) {
+            for (int s = 0; s < slots && slots > 1; ++s) {
+                int other = dist(cell * slots + s);
+                if (other != INF && addCost(other, turns.penalty) <= d) return true;
+            }
+            return false;
+        };
+
+        const DirectionTable* rules = options.directions;
+        SearchHeat* heat = options.heat;
+        vector<QueueEntry>& heap = scratch.heap;
+        auto push = [&](QueueEntry e) {
+            heap.push_back(e);
+            push_heap(heap.begin(), heap.end(), greater<QueueEntry>());
+        };
+        auto relax = [&](int from, int cell, int slot, int entry, int cost, int x, int y, int l) {
+            int state = cell * slots + slot;
+            if (cost >= dist(state) || dominated(cell, cost)) return;
+            scratch.label(state, cost, entry, from % slots);
+            push({addCost(cost, bound(x, y, l)), state, from});
+        };
+        if (fresh) {
+            int state = source * slots + slots - 1;
+            scratch.label(state, grid.at(sx, sy, sl), ENTRY_SOURCE);
+            push({addCost(dist(state), bound(sx, sy, sl)), state, -1});
+        }
+
+        const Move anyDirection[4] = {{0, 1, 1, 0, 0}, {1, 0, cols, 0, 1}, {-1, 0, -cols, 0, 2}, {0, -1, -1, 0, 3}};
+
+        while (!heap.empty()) {
+            if (singleTarget) {
+                int best = -1;
+                if (scratch.cellDistance(sink, &best) < heap.front().cost) return best;
+            } else if (done(heap.front().cost)) {
+                return -1;
+            }
+            pop_heap(heap.begin(), heap.end(), greater<QueueEntry>());
+            QueueEntry current = heap.back();
+            heap.pop_back();
+            int state = current.cell, here = state / slots, slot = state % slots;
+            int l = multiLayer ? here / plane : 0;
+            int x = here % plane / cols, y = here % cols;
+
+            int g = dist(state);
+            if (current.cost != addCost(g, bound(x, y, l)) || dominated(here, g)) continue;
+
+            if (++scratch.expanded > options.maxExpansions && options.maxExpansions > 0) {
+                scratch.capped = true;
+                return -1;
+            }
+            if (heat) heat->expansions[here]++;
+
+            const Move* movesBegin = rules ? rules->begin(l) : anyDirection;
+            const Move* movesEnd = rules ? rules->end(l) : anyDirection + 4;
+            for (const Move* move = movesBegin; move != movesEnd; ++move) {
+                int nx = x + move->dx, ny = y + move->dy;
+                if (!isValid(nx, ny, rows, cols)) continue;
+                int next = here + move->offset;
+                if (isBlocked(l, nx, ny)) {
+                    if (heat && isBlocked.taken(l, nx, ny)) heat->overflow[next]++;
+                    continue;
+                }
+                int cost = addCost(g, grid.at(nx, ny, l) + move->extra);
+                if (slots > 1 && move->dir != slot) cost = addCost(cost, turns.penalty);
+                relax(state, next, slots > 1 ? move->dir : 0, move->dir, cost, nx, ny, l);
+            }
+
+            // Via transitions
+            if constexpr (multiLayer && ViaPolicy::enabled) {
+                for (int nl : {l + 1, l - 1}) {
+                    if (nl < 0 || nl >= layers) continue;
+                    if (nl > l ? !vias.up(x, y, l) : !vias.down(x, y, l)) continue;
+                    int next = grid.index(x, y, nl);
+                    if (isBlocked(nl, x, y)) {
+                        if (heat && isBlocked.taken(nl, x, y)) heat->overflow[next]++;
+                        continue;
+                    }
+                    relax(state, next, slots - 1, nl > l ? ENTRY_UP : ENTRY_DOWN,
+                          addCost(g, vias.cost + grid.at(x, y, nl)), x, y, nl);
+                }
+            }
+        }
+        int best = -1;
+        if (singleTarget) scratch.cellDistance(sink, &best);
+        return best;
+    }
+
+    // Cell costs along the path plus the via cost for every layer change
+    // (turn penalties steer the search but are not part of the route cost).
+    template <class Path>
+    int computeTotalCost(const Path& path) const {
+        int totalCost = 0;
+        for (size_t i = 0; i < path.size(); ++i) {
+            auto [x, y, l] = path[i];
+            totalCost += grid.at(x, y, l);
+            if (i > 0) {
+                auto [px, py, pl] = path[i - 1];
+                if (pl != l) totalCost += vias.cost;
+            }
+        }
+        return totalCost;
+    }
+};
@@ -0,0 +1,399 @@
+#include "RouterCore.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <chrono>
+#include <random>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// Long-lived router service. The grid, via flags and (optionally) landmark
+// tables are loaded once; clients connect to a Unix domain socket and send
+// one request per line. Requests are queued onto a pool of workers, each
+// owning its search scratch, path arena and blockage grid, so a request pays
+// for its searches only. Several requests may be in flight per connection;
+// replies carry the request id and are written as each one completes.
+//
+// Build: g++ -std=c++17 -O2 -pthread -o RouterDaemon RouterDaemon.cpp
+//
+// Requests:
+//   ROUTE <id> <n> sx sy sl tx ty tl ...   route n nets in order against the
+//                                          resident grid, each routed net
+//                                          blocking the ones after it
+//   STATS                                  request count and latencies
+//   QUIT                                   close this connection
+//   SHUTDOWN                               finish queued work and exit
+// Replies:
+//   OK <id> <routed> <total cost> <latency us>, then n lines
+//   NET <id> <k> <cost> x y l x y l ...    (cost -1 and no cells if unrouted)
+//   ERR <id> <message>
+//   STATS <requests> <p50 us> <p99 us> <max us>
+//
+// Latency runs from the moment a request line is read to the moment its
+// reply is ready, so it includes time spent waiting for a worker. STATS
+// counts every request but takes the percentiles and maximum over the last
+// LATENCY_WINDOW ones.
+
+const int VIA_COST = 50;
+const int TURN_PENALTY = 10;
+const size_t LATENCY_WINDOW = 4096;
+
+using ServiceRouter = Router<MultiLayer, StackedVias, TurnPenalty>;
+using Clock = chrono::steady_clock;
+
+struct Connection {
+    int fd;
+    mutex writeLock;
+    explicit Connection(int _fd) : fd(_fd) {}
+    ~Connection() { close(fd); }
+
+    // Whole replies are written under the lock so concurrent replies on one
+    // connection never interleave.
+    void send(const string& reply) {
+        lock_guard<mutex> guard(writeLock);
+        size_t done = 0;
+        while (done < reply.size()) {
+            ssize_t n = ::send(fd, reply.data() + done, reply.size() - done, MSG_NOSIGNAL);
+            if (n <= 0) return;   // client went away
+            done += n;
+        }
+    }
+};
+
+struct Request {
+    shared_ptr<Connection> client;
+    string id;
+    vector<Net> nets;
+    Clock::time_point received;
+};
+
+struct RequestQueue {
+    mutex lock;
+    condition_variable ready;
+    deque<Request> pending;
+    bool closed = false;
+
+    // Queues a request; false once closed, when no worker would take it.
+    bool push(Request request) {
+        {
+            lock_guard<mutex> guard(lock);
+            if (closed) return false;
+            pending.push_back(move(request));
+        }
+        ready.notify_one();
+        return true;
+    }
+
+    // Blocks until a request is available; false once closed and drained.
+    bool pop(Request& request) {
+        unique_lock<mutex> guard(lock);
+        ready.wait(guard, [&] { return closed || !pending.empty(); });
+        if (pending.empty()) return false;
+        request = move(pending.front());
+        pending.pop_front();
+        return true;
+    }
+
+    void close() {
+        {
+            lock_guard<mutex> guard(lock);
+            closed = true;
+        }
+        ready.notify_all();
+    }
+};
+
+// Latencies of the most recent requests in a fixed ring, so memory and the
+// cost of STATS stay bounded however long the daemon runs.
+struct LatencyLog {
+    mutex lock;
+    vector<long long> recent;   // at most LATENCY_WINDOW, oldest overwritten first
+    long long requests = 0;
+
+    void add(long long us) {
+        lock_guard<mutex> guard(lock);
+        if (recent.size() < LATENCY_WINDOW) recent.push_back(us);
+        else recent[requests % LATENCY_WINDOW] = us;
+        requests++;
+    }
+
+    string report() {
+        vector<long long> sorted;
+        long long count;
+        {
+            lock_guard<mutex> guard(lock);
+            sorted = recent;
+            count = requests;
+        }
+        sort(sorted.begin(), sorted.end());
+        auto rank = [&](double p) {
+            if (sorted.empty()) return 0LL;
+            size_t k = (size_t)(p * sorted.size() + 0.999999);
+            return sorted[min(max(k, (size_t)1), sorted.size()) - 1];
+        };
+        ostringstream out;
+        out << "STATS " << count << " " << rank(0.50) << " " << rank(0.99) << " "
+            << (sorted.empty() ? 0 : sorted.back()) << "\n";
+        return out.str();
+    }
+};
+
+// Per-worker state kept for the daemon's lifetime.
+struct Workspace {
+    SearchScratch scratch;
+    Arena paths;
+    vector<uint8_t> blocked;
+    vector<size_t> touched;   // cells to unblock after the request
+};
+
+string routeRequest(const ServiceRouter& router, const SearchOptions& baseOptions,
+                    Workspace& work, const Request& request, LatencyLog& latencies) {
+    SearchOptions options = baseOptions;
+    options.scratch = &work.scratch;
+    work.paths.reset();
+
+    vector<PathRef> paths;
+    vector<int> costs;
+    int routed = 0, totalCost = 0;
+    for (const Net& net : request.nets) {
+        PathRef path = router.dijkstra3D(work.paths, work.blocked.data(), net.start, net.target, options);
+        int cost = -1;
+        if (!path.empty()) {
+            cost = router.computeTotalCost(path);
+            routed++;
+            totalCost += cost;
+            for (auto [x, y, l] : path) {
+                size_t cell = router.grid.index(x, y, l);
+                work.blocked[cell] = 1;
+                work.touched.push_back(cell);
+            }
+        }
+        paths.push_back(path);
+        costs.push_back(cost);
+    }
+    for (size_t cell : work.touched) work.blocked[cell] = 0;
+    work.touched.clear();
+
+    long long us = chrono::duration_cast<chrono::microseconds>(Clock::now() - request.received).count();
+    latencies.add(us);
+
+    ostringstream out;
+    out << "OK " << request.id << " " << routed << " " << totalCost << " " << us << "\n";
+    for (size_t k = 0; k < paths.size(); ++k) {
+        out << "NET " << request.id << " " << k << " " << costs[k];
+        for (auto [x, y, l] : paths[k]) out << " " << x << " " << y << " " << l;
+        out << "\n";
+    }
+    return out.str();
+}
+
+// Parses "ROUTE <id> <n> ..." into request; on failure returns the message.
+string parseRoute(istringstream& in, const RoutingGrid& grid, Request& request) {
+    int n;
+    if (!(in >> request.id)) return "missing id";
+    if (!(in >> n) || n < 0) return "bad net count";
+    for (int i = 0; i < n; ++i) {
+        int x1, y1, l1, x2, y2, l2;
+        if (!(in >> x1 >> y1 >> l1 >> x2 >> y2 >> l2)) return "expected 6 values per net";
+        if (!isValid(x1, y1, grid.rows, grid.cols) || !isValid(x2, y2, grid.rows, grid.cols) ||
+            l1 < 0 || l2 < 0 || l1 >= grid.layers || l2 >= grid.layers)
+            return "net " + to_string(i) + " out of grid";
+        request.nets.push_back({"Net" + to_string(i + 1), {x1, y1, l1}, {x2, y2, l2}});
+    }
+    return "";
+}
+
+// Grid file: "layers rows cols", then layers*rows*cols cell costs
+// ([layer][row][col]), then rows*cols via flags (0/1).
+bool loadGrid(const string& path, int& layers, int& rows, int& cols,
+              vector<int32_t>& costs, vector<uint8_t>& vias) {
+    ifstream in(path);
+    if (!(in >> layers >> rows >> cols) || layers <= 0 || rows <= 0 || cols <= 0) return false;
+    costs.resize((size_t)layers * rows * cols);
+    for (auto& c : costs)
+        if (!(in >> c)) return false;
+    vias.resize((size_t)rows * cols);
+    for (auto& v : vias) {
+        int flag;
+        if (!(in >> flag)) return false;
+        v = flag != 0;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    // --socket PATH (default /tmp/sgr.sock), --workers N, --grid FILE (else a
+    // random 7x10x10 floorplan from --seed, as in the order-optimised
+    // router), --turn-penalty N, --exact-turns and --landmarks FILE as in that
+    // router.
+    string socketPath = "/tmp/sgr.sock", gridFile, landmarkFile;
+    int workers = max(1u, thread::hardware_concurrency());
+    unsigned seed = random_device()();
+    int turnPenalty = TURN_PENALTY;
+    bool exactTurns = false;
+    for (int i = 1; i < argc; ++i) {
+        string flag = argv[i];
+        if (flag == "--socket" && i + 1 < argc) socketPath = argv[++i];
+        else if (flag == "--workers" && i + 1 < argc) workers = max(1, stoi(argv[++i]));
+        else if (flag == "--grid" && i + 1 < argc) gridFile = argv[++i];
+        else if (flag == "--seed" && i + 1 < argc) seed = stoul(argv[++i]);
+        else if (flag == "--landmarks" && i + 1 < argc) landmarkFile = argv[++i];
+        else if (flag == "--turn-penalty" && i + 1 < argc) turnPenalty = max(0, stoi(argv[++i]));
+        else if (flag == "--exact-turns") exactTurns = true;
+    }
+
+    int layers = 7, rows = 10, cols = 10;
+    vector<int32_t> costs;
+    vector<uint8_t> hasVia;
+    if (!gridFile.empty()) {
+        if (!loadGrid(gridFile, layers, rows, cols, costs, hasVia)) {
+            cerr << "Could not read grid from " << gridFile << "\n";
+            return 1;
+        }
+    } else {
+        mt19937 gen(seed);
+        uniform_int_distribution<> dist(1, 5);
+        costs.resize((size_t)layers * rows * cols);
+        for (auto& c : costs) c = dist(gen);
+        hasVia.assign((size_t)rows * cols, 0);
+        for (int i = 1; i < rows - 1; i++) {
+            hasVia[i * cols + i] = 1;
+            hasVia[(rows - 1 - i) * cols + i] = 1;
+        }
+    }
+
+    ServiceRouter router{{layers, rows, cols, costs.data()},
+                         {hasVia.data(), cols, VIA_COST},
+                         {turnPenalty}};
+
+    LandmarkTables landmarks;
+    if (!landmarkFile.empty()) {
+        uint64_t gridHash = hashFloorplan(router);
+        if (!loadLandmarks(landmarkFile, landmarks, router, gridHash)) {
+            buildLandmarks(router, landmarks);
+            if (!saveLandmarks(landmarkFile, landmarks, gridHash))
+                cerr << "Warning: could not write landmark tables to " << landmarkFile << "\n";
+        }
+    }
+    SearchOptions options;
+    options.landmarks = landmarks.empty() ? nullptr : &landmarks;
+    options.exactTurns = exactTurns;
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (listener < 0 || socketPath.size() >= sizeof(addr.sun_path)) {
+        cerr << "Invalid socket path " << socketPath << "\n";
+        return 1;
+    }
+    strcpy(addr.sun_path, socketPath.c_str());
+    unlink(socketPath.c_str());
+    if (bind(listener, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, 64) != 0) {
+        cerr << "Could not listen on " << socketPath << ": " << strerror(errno) << "\n";
+        return 1;
+    }
+
+    RequestQueue queue;
+    LatencyLog latencies;
+    atomic<bool> stopping{false};
+    mutex clientsLock;
+    vector<weak_ptr<Connection>> clients;
+    atomic<int> serving{0};   // connection threads still running
+
+    vector<thread> pool;
+    for (int w = 0; w < workers; ++w) {
+        pool.emplace_back([&] {
+            Workspace work;
+            work.blocked.assign(router.grid.size(), 0);
+            Request request;
+            while (queue.pop(request)) {
+                request.client->send(routeRequest(router, options, work, request, latencies));
+                request.client.reset();
+            }
+        });
+    }
+
+    auto serve = [&](shared_ptr<Connection> client) {
+        struct Done {
+            atomic<int>& count;
+            ~Done() { count--; }
+        } done{serving};
+        string buffer;
+        char chunk[4096];
+        ssize_t n;
+        while ((n = recv(client->fd, chunk, sizeof(chunk), 0)) > 0) {
+            buffer.append(chunk, n);
+            size_t eol;
+            while ((eol = buffer.find('\n')) != string::npos) {
+                string line = buffer.substr(0, eol);
+                buffer.erase(0, eol + 1);
+                istringstream in(line);
+                string command;
+                if (!(in >> command)) continue;
+
+                if (command == "ROUTE") {
+                    Request request;
+                    request.received = Clock::now();
+                    string error = parseRoute(in, router.grid, request);
+                    if (!error.empty()) {
+                        client->send("ERR " + (request.id.empty() ? "-" : request.id) + " " + error + "\n");
+                        continue;
+                    }
+                    request.client = client;
+                    string id = request.id;
+                    if (!queue.push(move(request))) client->send("ERR " + id + " shutting down\n");
+                } else if (command == "STATS") {
+                    client->send(latencies.report());
+                } else if (command == "QUIT") {
+                    return;
+                } else if (command == "SHUTDOWN") {
+                    stopping = true;
+                    shutdown(listener, SHUT_RDWR);   // wakes accept()
+                    return;
+                } else {
+                    client->send("ERR - unknown command " + command + "\n");
+                }
+            }
+        }
+    };
+
+    cerr << "Routing " << layers << "x" << rows << "x" << cols << " grid on " << workers
+         << " workers, listening on " << socketPath << "\n";
+    while (!stopping) {
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        auto client = make_shared<Connection>(fd);
+        {
+            // Closed connections are dropped here, so the list only holds
+            // the ones still open (or with replies still pending).
+            lock_guard<mutex> guard(clientsLock);
+            clients.erase(remove_if(clients.begin(), clients.end(),
+                                    [](const weak_ptr<Connection>& weak) { return weak.expired(); }),
+                          clients.end());
+            clients.push_back(client);
+        }
+        serving++;
+        thread(serve, client).detach();
+    }
+
+    // Queued requests are answered before the remaining connections are cut;
+    // requests read after the close are refused with ERR <id> shutting down.
+    queue.close();
+    for (auto& t : pool) t.join();
+    {
+        lock_guard<mutex> guard(clientsLock);
+        for (auto& weak : clients)
+            if (auto client = weak.lock()) shutdown(client->fd, SHUT_RDWR);
+    }
+    while (serving > 0) this_thread::sleep_for(chrono::milliseconds(1));
+    close(listener);
+    unlink(socketPath.c_str());
+    cerr << latencies.report();
+    return 0;
+}
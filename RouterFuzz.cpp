@@ -0,0 +1,590 @@
+#include "RouterCore.h"
+#include "RouterConcurrent.h"
+#include <numeric>
+#include <random>
+#include <sstream>
+
+// Differential checker for the search engines. Every case is generated from
+// a byte string: grid size, cell costs, vias, blockage, obstacle rectangles,
+// turn penalty and a few nets. The nets are routed in order (each routed net
+// blocks the next, as in the front ends) with the reference search - plain
+// dijkstra3D, no options. The reference itself must return the same path as
+// a frozen copy of the original nested-vector dijkstra3D (stacked vias, no
+// direction rules, turn penalties included). Every accelerated variant must
+// agree with the reference:
+//
+//   8/16-bit compact costs, reused scratch, obstacle index, an unreached
+//   expansion cap, heat counters (which must also add up to the expansion
+//   count), NoTurnPenalty vs TurnPenalty{0} and the SingleLayer
+//   specialisation, and
+//   exact turns (direction states)  -> a valid path of the oracle's cost
+//   one-to-many fanout trees        -> the same path as exact turns
+//   landmark (ALT) bounds           -> a valid path of the exact-turns
+//                                      objective cost
+//   concurrent routing              -> valid, disjoint paths
+//
+// Each combination runs with and without random per-layer direction rules.
+// Each path is also checked for validity (ends, adjacency, vias, blockage,
+// no repeated cells) and computeTotalCost is recomputed independently.
+// A Bellman-Ford oracle over (cell, incoming direction) states gives the
+// true optimum: the reference must reach it without turn penalties and never
+// beat it with them, and exact turns must reach it always.
+//
+// Randomised:  g++ -std=c++17 -O2 -pthread -o RouterFuzz RouterFuzz.cpp
+//              ./RouterFuzz [--cases N] [--seed S]
+// libFuzzer:   clang++ -std=c++17 -O1 -g -fsanitize=fuzzer,address
+//                  -DSGR_LIBFUZZER -o RouterFuzz RouterFuzz.cpp
+
+using Cell = tuple<int, int, int>;
+using Path = vector<Cell>;
+
+// Reads case parameters from the input bytes; zeros once they run out.
+struct ByteSource {
+    const uint8_t* data;
+    size_t size, at = 0;
+    int next(int lo, int hi) {   // in [lo, hi]
+        int b = at < size ? data[at++] : 0;
+        return lo + b % (hi - lo + 1);
+    }
+};
+
+struct FuzzCase {
+    int layers, rows, cols, viaCost, turnPenalty;
+    vector<int32_t> cost;
+    vector<uint8_t> via;          // rows*cols stacked flags
+    vector<uint8_t> upVia;        // rows*cols*layers upward flags
+    vector<uint8_t> blocked;      // pre-blocked cells (reference also gets obstacles)
+    vector<pair<int, Rect>> obstacles;
+    vector<Net> nets;
+    vector<LayerRule> rules;
+};
+
+FuzzCase makeCase(ByteSource& in) {
+    FuzzCase c;
+    c.layers = in.next(1, 4);
+    c.rows = in.next(1, 12);
+    c.cols = in.next(1, 12);
+    c.viaCost = in.next(0, 60);
+    c.turnPenalty = in.next(0, 3) == 0 ? 0 : in.next(1, 20);
+    int maxCost = in.next(0, 3) == 0 ? 255 : 9;
+    int minCost = in.next(0, 3) == 0 ? 0 : 1;   // zero-cost cells in a quarter of the cases
+    size_t cells = (size_t)c.layers * c.rows * c.cols;
+
+    c.cost.resize(cells);
+    for (auto& v : c.cost) v = in.next(minCost, maxCost);
+    int viaDensity = in.next(0, 8);
+    c.via.resize((size_t)c.rows * c.cols);
+    for (auto& v : c.via) v = in.next(0, 9) < viaDensity;
+    c.upVia.resize(cells);
+    for (auto& v : c.upVia) v = in.next(0, 9) < viaDensity;
+    int blockDensity = in.next(0, 4);
+    c.blocked.resize(cells);
+    for (auto& v : c.blocked) v = in.next(0, 9) < blockDensity;
+
+    int rects = in.next(0, 3);
+    for (int i = 0; i < rects; ++i) {
+        int l = in.next(0, c.layers - 1);
+        int x1 = in.next(0, c.rows - 1), y1 = in.next(0, c.cols - 1);
+        int x2 = in.next(0, c.rows - 1), y2 = in.next(0, c.cols - 1);
+        c.obstacles.push_back({l, {min(x1, x2), min(y1, y2), max(x1, x2), max(y1, y2)}});
+    }
+    for (int l = 0; l < c.layers; ++l) {
+        LayerRule rule;
+        rule.preferred = LayerRule::Direction(in.next(0, 2));
+        int mode = in.next(0, 2);
+        rule.wrongWayCost = mode == 0 ? 0 : mode == 1 ? in.next(1, 15) : WRONG_WAY_FORBIDDEN;
+        c.rules.push_back(rule);
+    }
+    int nets = in.next(1, 4);
+    for (int i = 0; i < nets; ++i) {
+        Cell s = {in.next(0, c.rows - 1), in.next(0, c.cols - 1), in.next(0, c.layers - 1)};
+        Cell t = {in.next(0, c.rows - 1), in.next(0, c.cols - 1), in.next(0, c.layers - 1)};
+        c.nets.push_back({"Net" + to_string(i + 1), s, t});
+    }
+    return c;
+}
+
+string describe(const Path& path) {
+    ostringstream out;
+    for (auto [x, y, l] : path) out << "(" << x << "," << y << "," << l << ")";
+    return out.str();
+}
+
+// Extra cost of an in-plane move under the direction rules, -1 if forbidden.
+int moveExtra(const DirectionTable* rules, int l, int dx, int dy) {
+    if (!rules) return 0;
+    for (const Move* m = rules->begin(l); m != rules->end(l); ++m)
+        if (m->dx == dx && m->dy == dy) return m->extra;
+    return -1;
+}
+
+// Cost the search minimises: cells, vias, wrong-way extras and a turn penalty
+// for every in-plane move whose direction differs from the previous move (the
+// first move out of the source and the first move after a via count as turns).
+template <class R>
+long long objective(const R& router, const Path& path, const DirectionTable* rules) {
+    long long total = 0;
+    long long prevDelta = 0;
+    for (size_t i = 0; i < path.size(); ++i) {
+        auto [x, y, l] = path[i];
+        total += router.grid.at(x, y, l);
+        if (i == 0) continue;
+        auto [px, py, pl] = path[i - 1];
+        long long delta = (long long)router.grid.index(x, y, l) - (long long)router.grid.index(px, py, pl);
+        if (pl != l) {
+            total += router.vias.cost;
+        } else {
+            total += moveExtra(rules, l, x - px, y - py);
+            if (delta != prevDelta) total += router.turns.penalty;
+        }
+        prevDelta = delta;
+    }
+    return total;
+}
+
+// Returns an empty string if path is a legal route from s to t avoiding
+// isBlocked, else what is wrong with it.
+template <class R, class Blocked>
+string checkPath(const R& router, const Path& path, Cell s, Cell t, Blocked isBlocked,
+                 const DirectionTable* rules = nullptr) {
+    const auto& g = router.grid;
+    if (path.front() != s) return "does not start at the source";
+    if (path.back() != t) return "does not end at the target";
+    vector<uint8_t> seen(g.size(), 0);
+    int computed = 0;
+    for (size_t i = 0; i < path.size(); ++i) {
+        auto [x, y, l] = path[i];
+        if (!isValid(x, y, g.rows, g.cols) || l < 0 || l >= g.layers) return "leaves the grid";
+        if (isBlocked(x, y, l)) return "crosses a blocked cell";
+        if (seen[g.index(x, y, l)]++) return "visits a cell twice";
+        computed += g.at(x, y, l);
+        if (i == 0) continue;
+        auto [px, py, pl] = path[i - 1];
+        if (pl == l) {
+            if (abs(px - x) + abs(py - y) != 1) return "jumps between cells";
+            if (moveExtra(rules, l, x - px, y - py) < 0) return "makes a forbidden wrong-way move";
+        } else {
+            if (px != x || py != y || abs(pl - l) != 1) return "changes layer off a via";
+            bool up = l > pl;
+            if (up ? !router.vias.up(x, y, pl) : !router.vias.down(x, y, pl)) return "uses a missing via";
+            computed += router.vias.cost;
+        }
+    }
+    if (computed != router.computeTotalCost(path)) return "computeTotalCost disagrees";
+    return "";
+}
+
+// Independent optimum of objective(): Bellman-Ford over (cell, entry) states,
+// entry 0-3 being the direction of the move into the cell and 4 a via or the
+// source, so every turn penalty is charged exactly.
+template <class R, class Blocked>
+long long oracleCost(const R& router, Cell s, Cell t, Blocked isBlocked, const DirectionTable* rules) {
+    const auto& g = router.grid;
+    const long long UNREACHED = LLONG_MAX;
+    const int moves[4][2] = {{0, 1}, {1, 0}, {-1, 0}, {0, -1}};
+    const int VIA_ENTRY = 4;
+    vector<long long> d(g.size() * 5, UNREACHED);
+    auto [sx, sy, sl] = s;
+    if (isBlocked(sx, sy, sl)) return UNREACHED;
+    d[g.index(sx, sy, sl) * 5 + VIA_ENTRY] = g.at(sx, sy, sl);
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (int l = 0; l < g.layers; ++l)
+            for (int x = 0; x < g.rows; ++x)
+                for (int y = 0; y < g.cols; ++y)
+                    for (int e = 0; e < 5; ++e) {
+                        long long here = d[g.index(x, y, l) * 5 + e];
+                        if (here == UNREACHED) continue;
+                        auto relax = [&](int nx, int ny, int nl, int entry, long long step) {
+                            if (!isValid(nx, ny, g.rows, g.cols) || nl < 0 || nl >= g.layers) return;
+                            if (step < 0) return;   // forbidden move
+                            if (isBlocked(nx, ny, nl)) return;
+                            long long& there = d[g.index(nx, ny, nl) * 5 + entry];
+                            if (here + step + g.at(nx, ny, nl) < there) {
+                                there = here + step + g.at(nx, ny, nl);
+                                changed = true;
+                            }
+                        };
+                        for (int k = 0; k < 4; ++k) {
+                            int dx = moves[k][0], dy = moves[k][1];
+                            long long extra = moveExtra(rules, l, dx, dy);
+                            if (extra >= 0 && k != e) extra += router.turns.penalty;
+                            relax(x + dx, y + dy, l, k, extra);
+                        }
+                        if (router.vias.up(x, y, l)) relax(x, y, l + 1, VIA_ENTRY, router.vias.cost);
+                        if (router.vias.down(x, y, l)) relax(x, y, l - 1, VIA_ENTRY, router.vias.cost);
+                    }
+    }
+    auto [tx, ty, tl] = t;
+    size_t sink = g.index(tx, ty, tl) * 5;
+    return *min_element(d.begin() + sink, d.begin() + sink + 5);
+}
+
+// The nested-vector dijkstra3D of the original order-optimised router, kept
+// as it was (only VIA_COST and TURN_PENALTY became parameters), so the
+// default search is checked against the code it replaced and not against
+// itself.
+namespace original {
+
+struct DirNode {
+    int x, y, layer, cost;
+    int px, py, pl; // previous x,y,layer to compute direction change
+    DirNode(int _x, int _y, int _layer, int _cost, int _px, int _py, int _pl)
+        : x(_x), y(_y), layer(_layer), cost(_cost), px(_px), py(_py), pl(_pl) {}
+    bool operator>(const DirNode& other) const {
+        return cost > other.cost;
+    }
+};
+
+vector<tuple<int, int, int>> dijkstra3D(
+    const vector<vector<vector<int>>>& grid,
+    const vector<vector<bool>>& hasVia,
+    const vector<vector<vector<bool>>>& blocked,
+    tuple<int, int, int> start,
+    tuple<int, int, int> target,
+    int VIA_COST,
+    int TURN_PENALTY
+) {
+    int layers = grid.size(), rows = grid[0].size(), cols = grid[0][0].size();
+
+    vector<vector<vector<int>>> dist(layers, vector<vector<int>>(rows, vector<int>(cols, INF)));
+    vector<vector<vector<tuple<int, int, int>>>> parent(layers, vector<vector<tuple<int, int, int>>>(rows, vector<tuple<int, int, int>>(cols, {-1, -1, -1})));
+
+    auto [sx, sy, sl] = start;
+    auto [tx, ty, tl] = target;
+
+    if (blocked[sl][sx][sy] || blocked[tl][tx][ty])
+        return {};
+
+    dist[sl][sx][sy] = grid[sl][sx][sy];
+    priority_queue<DirNode, vector<DirNode>, greater<DirNode>> pq;
+    pq.push(DirNode(sx, sy, sl, grid[sl][sx][sy], sx, sy, sl));
+
+    vector<pair<int, int>> directions = {{0,1},{1,0},{-1,0},{0,-1}};
+
+    while (!pq.empty()) {
+        DirNode current = pq.top(); pq.pop();
+        int x = current.x, y = current.y, l = current.layer;
+
+        if (make_tuple(x, y, l) == target) break;
+
+        for (auto [dx, dy] : directions) {
+            int nx = x + dx, ny = y + dy;
+            if (isValid(nx, ny, rows, cols) && !blocked[l][nx][ny]) {
+                int baseCost = dist[l][x][y] + grid[l][nx][ny];
+
+                // Check for turn
+                int prev_dx = x - current.px;
+                int prev_dy = y - current.py;
+                if (make_pair(dx, dy) != make_pair(prev_dx, prev_dy)) {
+                    baseCost += TURN_PENALTY;
+                }
+
+                if (baseCost < dist[l][nx][ny]) {
+                    dist[l][nx][ny] = baseCost;
+                    parent[l][nx][ny] = {x, y, l};
+                    pq.push(DirNode(nx, ny, l, baseCost, x, y, l));
+                }
+            }
+        }
+
+        // Via transitions
+        if (hasVia[x][y]) {
+            if (l + 1 < layers && !blocked[l + 1][x][y]) {
+                int newCost = dist[l][x][y] + VIA_COST + grid[l + 1][x][y];
+                if (newCost < dist[l + 1][x][y]) {
+                    dist[l + 1][x][y] = newCost;
+                    parent[l + 1][x][y] = {x, y, l};
+                    pq.push(DirNode(x, y, l + 1, newCost, x, y, l));
+                }
+            }
+            if (l - 1 >= 0 && !blocked[l - 1][x][y]) {
+                int newCost = dist[l][x][y] + VIA_COST + grid[l - 1][x][y];
+                if (newCost < dist[l - 1][x][y]) {
+                    dist[l - 1][x][y] = newCost;
+                    parent[l - 1][x][y] = {x, y, l};
+                    pq.push(DirNode(x, y, l - 1, newCost, x, y, l));
+                }
+            }
+        }
+    }
+
+    vector<tuple<int, int, int>> path;
+    if (dist[tl][tx][ty] == INF) return {};
+
+    tuple<int, int, int> p = target;
+    while (p != make_tuple(-1, -1, -1)) {
+        path.push_back(p);
+        p = parent[get<2>(p)][get<0>(p)][get<1>(p)];
+    }
+    reverse(path.begin(), path.end());
+    return path;
+}
+
+}  // namespace original
+
+struct Checker {
+    vector<string> failures;
+    void fail(const string& what) { failures.push_back(what); }
+};
+
+// Runs one policy combination over the case. R is the reference router; the
+// compact variants share its vias and turn policy.
+template <class LayerP, class ViaP, class TurnP>
+void checkEngines(const FuzzCase& c, const ViaP& vias, const TurnP& turns, string name,
+                  Checker& check, const DirectionTable* rules = nullptr) {
+    if (rules) name += "+rules";
+    using R = Router<LayerP, ViaP, TurnP>;
+    R ref{{c.layers, c.rows, c.cols, c.cost.data()}, vias, turns};
+    const auto& g = ref.grid;
+
+    Router<LayerP, ViaP, TurnP, CompactGrid<uint8_t>> ref8{{}, vias, turns};
+    Router<LayerP, ViaP, TurnP, CompactGrid<uint16_t>> ref16{{}, vias, turns};
+    bool have8 = compactCosts(g, ref8.grid), have16 = compactCosts(g, ref16.grid);
+
+    ObstacleMap obstacles(c.layers, c.rows, c.cols);
+    for (auto [l, r] : c.obstacles) obstacles.add(l, r);
+
+    LandmarkTables landmarks;
+    buildLandmarks(ref, landmarks);
+
+    // The reference sees obstacles rasterised into its blockage grid; the
+    // variants get the pre-blocked cells plus the obstacle index.
+    vector<uint8_t> refBlocked = c.blocked, blocked = c.blocked;
+    for (auto [l, r] : c.obstacles)
+        for (int x = r.x1; x <= r.x2; ++x)
+            for (int y = r.y1; y <= r.y2; ++y) refBlocked[g.index(x, y, l)] = 1;
+    auto isBlocked = [&](int x, int y, int l) { return refBlocked[g.index(x, y, l)] != 0; };
+
+    // The same case in the original router's [layer][x][y] / [x][y] layout.
+    vector<vector<vector<int>>> nestedCost(c.layers, vector<vector<int>>(c.rows, vector<int>(c.cols)));
+    vector<vector<bool>> nestedVia(c.rows, vector<bool>(c.cols));
+    for (int l = 0; l < c.layers; ++l)
+        for (int x = 0; x < c.rows; ++x)
+            for (int y = 0; y < c.cols; ++y) {
+                nestedCost[l][x][y] = c.cost[g.index(x, y, l)];
+                nestedVia[x][y] = c.via[(size_t)x * c.cols + y] != 0;
+            }
+    auto nestedBlocked = [&] {
+        vector<vector<vector<bool>>> out(c.layers, vector<vector<bool>>(c.rows, vector<bool>(c.cols)));
+        for (int l = 0; l < c.layers; ++l)
+            for (int x = 0; x < c.rows; ++x)
+                for (int y = 0; y < c.cols; ++y) out[l][x][y] = isBlocked(x, y, l);
+        return out;
+    };
+
+    // Fanout from the first net's source to every pin, settled in two rounds
+    // on one tree, against separate searches on the same blockage.
+    Path pins;
+    for (const Net& net : c.nets) {
+        pins.push_back(net.target);
+        pins.push_back(net.start);
+    }
+    SearchOptions base;   // the reference's options: only the direction rules
+    base.directions = rules;
+    SearchOptions exact = base;
+    exact.exactTurns = true;
+    {
+        SearchOptions options = base;
+        options.obstacles = &obstacles;
+        SourceTree tree;
+        ref.plantTree(tree, blocked.data(), c.nets[0].start, options);
+        size_t half = pins.size() / 2;
+        auto paths = ref.routeFanout(tree, Path(pins.begin(), pins.begin() + half));
+        auto rest = ref.routeFanout(tree, Path(pins.begin() + half, pins.end()));
+        paths.insert(paths.end(), rest.begin(), rest.end());
+        for (size_t k = 0; k < pins.size(); ++k) {
+            Path single = ref.dijkstra3D(refBlocked.data(), c.nets[0].start, pins[k], exact);
+            if (paths[k] != single)
+                check.fail(name + " fanout pin " + to_string(k) + ": " +
+                           describe(paths[k]) + " != " + describe(single));
+        }
+    }
+
+    SearchScratch reused;
+    for (size_t k = 0; k < c.nets.size(); ++k) {
+        const Net& net = c.nets[k];
+        string where = name + " net " + to_string(k) + ": ";
+        Path expected = ref.dijkstra3D(refBlocked.data(), net.start, net.target, base);
+
+        long long expectedCost = LLONG_MAX;
+        if (!expected.empty()) {
+            string bad = checkPath(ref, expected, net.start, net.target, isBlocked, rules);
+            if (!bad.empty()) check.fail(where + "reference path " + bad + " " + describe(expected));
+            expectedCost = objective(ref, expected, rules);
+        }
+        // The reference is optimal without turn penalties; with them its
+        // per-cell labels may miss the optimum but never beat it.
+        long long optimum = oracleCost(ref, net.start, net.target, isBlocked, rules);
+        if (turns.penalty == 0 ? expectedCost != optimum : expectedCost < optimum)
+            check.fail(where + "reference cost " + to_string(expectedCost) + ", oracle " + to_string(optimum));
+        if constexpr (LayerP::multiLayer && is_same_v<ViaP, StackedVias>) {
+            if (!rules) {
+                Path frozen = original::dijkstra3D(nestedCost, nestedVia, nestedBlocked(),
+                                                   net.start, net.target, vias.cost, turns.penalty);
+                if (frozen != expected)
+                    check.fail(where + "reference path " + describe(expected) +
+                               " != original " + describe(frozen));
+            }
+        }
+
+        auto same = [&](const string& variant, const Path& got) {
+            if (got != expected)
+                check.fail(where + variant + " path " + describe(got) + " != " + describe(expected));
+        };
+        SearchOptions options = base;
+        options.obstacles = &obstacles;
+        same("obstacle index", ref.dijkstra3D(blocked.data(), net.start, net.target, options));
+        options.scratch = &reused;
+        same("reused scratch", ref.dijkstra3D(blocked.data(), net.start, net.target, options));
+        options.maxExpansions = 8 * (long long)g.size();   // never reached
+        same("expansion cap", ref.dijkstra3D(blocked.data(), net.start, net.target, options));
+
+        // Heat counters change nothing, count every expansion and only
+        // charge overflow to cells held in the blockage grid.
+        SearchHeat heat(c.layers, c.rows, c.cols);
+        SearchOptions counted = options;
+        counted.heat = &heat;
+        same("heat", ref.dijkstra3D(blocked.data(), net.start, net.target, counted));
+        if (accumulate(heat.expansions.begin(), heat.expansions.end(), 0LL) != reused.expanded)
+            check.fail(where + "heat expansions != " + to_string(reused.expanded));
+        for (size_t i = 0; i < heat.overflow.size(); ++i)
+            if (heat.overflow[i] && !blocked[i]) check.fail(where + "overflow on free cell " + to_string(i));
+        if (have8) same("8-bit", ref8.dijkstra3D(blocked.data(), net.start, net.target, options));
+        if (have16) same("16-bit", ref16.dijkstra3D(blocked.data(), net.start, net.target, options));
+
+        Arena arena;
+        PathRef inArena = ref.dijkstra3D(arena, blocked.data(), net.start, net.target, options);
+        same("arena", Path(inArena.begin(), inArena.end()));
+
+        if constexpr (!TurnP::enabled) {
+            Router<LayerP, ViaP, TurnPenalty> zero{{c.layers, c.rows, c.cols, c.cost.data()}, vias, {0}};
+            same("TurnPenalty{0}", zero.dijkstra3D(refBlocked.data(), net.start, net.target, base));
+        }
+        if constexpr (!LayerP::multiLayer) {
+            // Layer 0 only: the 2D router must match the 3D one on a 1-layer grid.
+            if (c.layers == 1) {
+                Router<MultiLayer, ViaP, TurnP> flat{{1, c.rows, c.cols, c.cost.data()}, vias, turns};
+                same("MultiLayer", flat.dijkstra3D(refBlocked.data(), net.start, net.target, base));
+            }
+        }
+
+        // Direction states: a legal route of the oracle's cost; landmark
+        // bounds must keep it.
+        Path best = ref.dijkstra3D(refBlocked.data(), net.start, net.target, exact);
+        long long bestCost = LLONG_MAX;
+        if (best.empty() != expected.empty()) {
+            check.fail(where + "exact turns disagree on routability");
+        } else if (!best.empty()) {
+            string bad = checkPath(ref, best, net.start, net.target, isBlocked, rules);
+            if (!bad.empty()) check.fail(where + "exact-turns path " + bad);
+            bestCost = objective(ref, best, rules);
+            if (bestCost != optimum)
+                check.fail(where + "exact-turns cost " + to_string(bestCost) +
+                           ", oracle " + to_string(optimum));
+        }
+        SearchOptions alt = exact;
+        alt.landmarks = &landmarks;
+        alt.obstacles = &obstacles;
+        Path withBounds = ref.dijkstra3D(blocked.data(), net.start, net.target, alt);
+        if (withBounds.empty() != best.empty()) {
+            check.fail(where + "landmarks disagree on routability");
+        } else if (!withBounds.empty()) {
+            string bad = checkPath(ref, withBounds, net.start, net.target, isBlocked, rules);
+            if (!bad.empty()) check.fail(where + "landmark path " + bad);
+            long long cost = objective(ref, withBounds, rules);
+            if (cost != bestCost)
+                check.fail(where + "landmark cost " + to_string(cost) + " != " + to_string(bestCost));
+        }
+
+        for (auto [x, y, l] : expected) {
+            refBlocked[g.index(x, y, l)] = 1;
+            blocked[g.index(x, y, l)] = 1;
+        }
+    }
+}
+
+// Concurrent routing: every committed path must be legal and no cell may be
+// shared between nets.
+void checkConcurrent(const FuzzCase& c, Checker& check) {
+    Router<MultiLayer, StackedVias, TurnPenalty> router{
+        {c.layers, c.rows, c.cols, c.cost.data()}, {c.via.data(), c.cols, c.viaCost}, {c.turnPenalty}};
+    const auto& g = router.grid;
+    OccupancyMap occupancy(g.size());
+    for (size_t i = 0; i < g.size(); ++i)
+        if (c.blocked[i]) occupancy.tryClaim(i);
+    ConcurrentStats stats;
+    ConcurrentResult result = routeConcurrent(router, c.nets, 3, occupancy, stats);
+
+    vector<uint8_t> owner(g.size(), 0);
+    auto preBlocked = [&](int x, int y, int l) { return c.blocked[g.index(x, y, l)] != 0; };
+    for (size_t k = 0; k < c.nets.size(); ++k) {
+        const Path& path = result.paths[k];
+        if (path.empty()) continue;
+        string bad = checkPath(router, path, c.nets[k].start, c.nets[k].target, preBlocked);
+        if (!bad.empty()) check.fail("concurrent net " + to_string(k) + ": path " + bad);
+        for (auto [x, y, l] : path)
+            if (owner[g.index(x, y, l)]++) check.fail("concurrent net " + to_string(k) + ": shares a cell");
+    }
+}
+
+vector<string> runCase(const uint8_t* data, size_t size) {
+    ByteSource in{data, size};
+    FuzzCase c = makeCase(in);
+    Checker check;
+    StackedVias stacked{c.via.data(), c.cols, c.viaCost};
+    UpwardVias upward{c.upVia.data(), c.cols, c.layers, c.viaCost};
+
+    checkEngines<MultiLayer, StackedVias, TurnPenalty>(c, stacked, {c.turnPenalty}, "stacked+turns", check);
+    checkEngines<MultiLayer, StackedVias, NoTurnPenalty>(c, stacked, {}, "stacked", check);
+    checkEngines<MultiLayer, UpwardVias, NoTurnPenalty>(c, upward, {}, "upward", check);
+    if (c.layers == 1)
+        checkEngines<SingleLayer, NoVias, NoTurnPenalty>(c, NoVias{}, {}, "2d", check);
+
+    DirectionTable rules = compileDirections(c.rules, c.cols);
+    checkEngines<MultiLayer, StackedVias, TurnPenalty>(c, stacked, {c.turnPenalty}, "stacked+turns", check, &rules);
+    checkEngines<MultiLayer, StackedVias, NoTurnPenalty>(c, stacked, {}, "stacked", check, &rules);
+    checkEngines<MultiLayer, UpwardVias, NoTurnPenalty>(c, upward, {}, "upward", check, &rules);
+    if (c.layers == 1)
+        checkEngines<SingleLayer, NoVias, NoTurnPenalty>(c, NoVias{}, {}, "2d", check, &rules);
+    checkConcurrent(c, check);
+    return check.failures;
+}
+
+#ifdef SGR_LIBFUZZER
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    vector<string> failures = runCase(data, size);
+    if (!failures.empty()) {
+        for (const auto& f : failures) cerr << f << "\n";
+        abort();
+    }
+    return 0;
+}
+#else
+int main(int argc, char* argv[]) {
+    long long cases = 10000;
+    unsigned seed = random_device()();
+    for (int i = 1; i < argc; ++i) {
+        string flag = argv[i];
+        if (flag == "--cases" && i + 1 < argc) cases = stoll(argv[++i]);
+        else if (flag == "--seed" && i + 1 < argc) seed = stoul(argv[++i]);
+    }
+
+    // Case k is generated from seed + k, so a failure is reproduced with
+    // --seed <seed + k> --cases 1.
+    long long failed = 0;
+    for (long long k = 0; k < cases; ++k) {
+        mt19937 gen(seed + k);
+        vector<uint8_t> bytes(8192);
+        for (auto& b : bytes) b = gen();
+        vector<string> failures = runCase(bytes.data(), bytes.size());
+        if (failures.empty()) continue;
+        if (failed++ < 5) {
+            cout << "Case " << k << " (--seed " << seed + k << " --cases 1):\n";
+            for (const auto& f : failures) cout << "  " << f << "\n";
+        }
+    }
+    cout << cases << " cases, " << failed << " failed (seed " << seed << ")\n";
+    return failed ? 1 : 0;
+}
+#endif
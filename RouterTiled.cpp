@@ -0,0 +1,618 @@
+#include "RouterCore.h"
+#include <chrono>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+// Tiled multi-process router for dies whose search state does not fit in
+// one process. The die is cut into square tiles; each tile is stored in its
+// own file together with a halo of neighbouring cells (cell costs, via flags
+// and a taken flag per cell), and files are memory-mapped shared, so every
+// process works on the same pages and only ever touches a few tiles. No
+// process holds die-sized data: the search runs on one tile window at a
+// time, so peak RSS follows the tile size.
+//
+// Build: g++ -std=c++17 -O2 -o RouterTiled RouterTiled.cpp
+//
+// Routing runs in forked processes:
+//   1. nets whose pins lie in different tiles are stitched by one process,
+//      tile by tile: from the current cell it grows a tree over the tile
+//      window, picks the window-edge cell (or the target) with the lowest
+//      cost + remaining lower bound, keeps the route up to where it leaves
+//      the tile and continues from that cell in the next tile;
+//   2. nets inside one tile are routed within that tile's window by a pool
+//      of worker processes, in four phases by tile parity. Windows of tiles
+//      with the same parity do not overlap (halo * 2 <= tile size), so the
+//      workers never read cells another one writes and the result does not
+//      depend on the number of workers.
+// A claimed cell is marked taken in every tile file whose window holds it.
+//
+// Usage:
+//   RouterTiled --tiles DIR [--grid FILE | --die LxRxC --seed S]
+//               [--tile N] [--halo H] [--workers N] [--routes FILE]
+// --grid takes the text grid format of RouterDaemon and is streamed into the
+// tile files a row at a time; --die makes a synthetic die of that size. Nets
+// come from stdin as a count followed by "sx sy sl tx ty tl" lines. --routes
+// writes "NET k cost x y l ..." per net (cost -1 and no cells if unrouted).
+
+const int VIA_COST = 50;
+const int TURN_PENALTY = 10;
+
+using TileRouter = Router<MultiLayer, StackedVias, TurnPenalty>;
+using Path = vector<tuple<int, int, int>>;
+
+const char TILE_MAGIC[8] = {'S', 'G', 'R', 'T', 'I', 'L', '0', '1'};
+
+// File layout: header, int32 costs [layer][row][col] of the window, uint8
+// via flags [row][col], uint8 taken flags [layer][row][col].
+struct TileHeader {
+    char magic[8];
+    int32_t layers, x0, y0, rows, cols;   // window of rows x cols cells at (x0, y0)
+};
+
+// Tile (i, j) owns rows [i * size, (i + 1) * size) and the same columns; its
+// window adds halo cells on every side, clipped to the die.
+struct TileLayout {
+    int layers, rows, cols, size, halo;
+    int tileRows, tileCols;
+    int minCost = 1;   // smallest cell cost, for the remaining-cost bound
+    string dir;
+
+    TileLayout(int _layers, int _rows, int _cols, int _size, int _halo, string _dir)
+        : layers(_layers), rows(_rows), cols(_cols), size(_size), halo(_halo),
+          tileRows((_rows + _size - 1) / _size), tileCols((_cols + _size - 1) / _size),
+          dir(move(_dir)) {}
+
+    int count() const { return tileRows * tileCols; }
+    int owner(int x, int y) const { return x / size * tileCols + y / size; }
+    Rect core(int t) const {
+        int i = t / tileCols, j = t % tileCols;
+        return {i * size, j * size, min((i + 1) * size, rows) - 1, min((j + 1) * size, cols) - 1};
+    }
+    Rect window(int t) const {
+        Rect r = core(t);
+        return {max(r.x1 - halo, 0), max(r.y1 - halo, 0),
+                min(r.x2 + halo, rows - 1), min(r.y2 + halo, cols - 1)};
+    }
+    // Same-parity tiles are routed concurrently.
+    int phase(int t) const { return t / tileCols % 2 * 2 + t % tileCols % 2; }
+
+    size_t fileBytes(int t) const {
+        Rect w = window(t);
+        size_t plane = (size_t)(w.x2 - w.x1 + 1) * (w.y2 - w.y1 + 1);
+        return sizeof(TileHeader) + plane * layers * 5 + plane;
+    }
+    string name(int t) const {
+        return dir + "/tile_" + to_string(t / tileCols) + "_" + to_string(t % tileCols);
+    }
+};
+
+inline bool contains(const Rect& r, int x, int y) {
+    return x >= r.x1 && x <= r.x2 && y >= r.y1 && y <= r.y2;
+}
+
+// ---------------------------------------------------------------------------
+// Tile files
+// ---------------------------------------------------------------------------
+
+// Creates every tile file, then streams the die into them: costRow(l, x, out)
+// yields the costs of row x on layer l and viaRow(x, out) its via flags, in
+// file order. Only the files of the current band of tile rows are open and
+// one die row is buffered.
+bool buildTiles(TileLayout& layout,
+                const function<bool(int, int, vector<int32_t>&)>& costRow,
+                const function<bool(int, vector<uint8_t>&)>& viaRow) {
+    for (int t = 0; t < layout.count(); ++t) {
+        Rect w = layout.window(t);
+        TileHeader header;
+        memcpy(header.magic, TILE_MAGIC, sizeof(header.magic));
+        header.layers = layout.layers;
+        header.x0 = w.x1; header.y0 = w.y1;
+        header.rows = w.x2 - w.x1 + 1; header.cols = w.y2 - w.y1 + 1;
+        int fd = open((layout.name(t) + ".sgt").c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return false;
+        bool ok = pwrite(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+                  ftruncate(fd, layout.fileBytes(t)) == 0;   // taken flags start zero
+        close(fd);
+        if (!ok) return false;
+    }
+
+    // Writes die row x of one section (layer l's costs, or the via flags
+    // when l < 0) into every window holding that row.
+    map<int, int> files;   // tile -> fd, for the band being written
+    auto write = [&](int l, int x, const void* row, size_t cellBytes) {
+        int first = max(x - layout.halo, 0) / layout.size;
+        int last = min(x + layout.halo, layout.rows - 1) / layout.size;
+        for (int i = first; i <= last; ++i) {
+            for (int j = 0; j < layout.tileCols; ++j) {
+                int t = i * layout.tileCols + j;
+                Rect w = layout.window(t);
+                auto it = files.find(t);
+                if (it == files.end()) {
+                    int fd = open((layout.name(t) + ".sgt").c_str(), O_WRONLY);
+                    if (fd < 0) return false;
+                    it = files.emplace(t, fd).first;
+                }
+                size_t width = w.y2 - w.y1 + 1, plane = (w.x2 - w.x1 + 1) * width;
+                size_t section = l >= 0 ? sizeof(int32_t) * plane * l : sizeof(int32_t) * plane * layout.layers;
+                size_t offset = sizeof(TileHeader) + section + cellBytes * width * (x - w.x1);
+                const char* from = static_cast<const char*>(row) + cellBytes * w.y1;
+                if (pwrite(it->second, from, cellBytes * width, offset) != (ssize_t)(cellBytes * width))
+                    return false;
+                if (w.x2 == x) {
+                    close(it->second);
+                    files.erase(it);
+                }
+            }
+        }
+        return true;
+    };
+
+    vector<int32_t> costs(layout.cols);
+    vector<uint8_t> vias(layout.cols);
+    layout.minCost = INF;
+    bool ok = true;
+    for (int l = 0; ok && l < layout.layers; ++l) {
+        for (int x = 0; ok && x < layout.rows; ++x) {
+            ok = costRow(l, x, costs) && write(l, x, costs.data(), sizeof(int32_t));
+            for (int32_t c : costs) layout.minCost = min(layout.minCost, c);
+        }
+    }
+    for (int x = 0; ok && x < layout.rows; ++x)
+        ok = viaRow(x, vias) && write(-1, x, vias.data(), 1);
+    for (auto [t, fd] : files) close(fd);
+    layout.minCost = max(layout.minCost, 0);
+    return ok;
+}
+
+// A tile file mapped read-write and shared with every other process.
+struct TileView {
+    void* base = MAP_FAILED;
+    size_t bytes = 0;
+    TileHeader header;
+    int32_t* cost = nullptr;
+    uint8_t* via = nullptr;
+    uint8_t* taken = nullptr;
+
+    TileView() = default;
+    TileView(const TileView&) = delete;
+    ~TileView() {
+        if (base != MAP_FAILED) munmap(base, bytes);
+    }
+
+    bool open(const TileLayout& layout, int t) {
+        int fd = ::open((layout.name(t) + ".sgt").c_str(), O_RDWR);
+        if (fd < 0) return false;
+        bytes = layout.fileBytes(t);
+        struct stat st;
+        if (fstat(fd, &st) == 0 && (size_t)st.st_size == bytes)
+            base = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED) return false;
+
+        memcpy(&header, base, sizeof(header));
+        if (memcmp(header.magic, TILE_MAGIC, sizeof(header.magic)) != 0) return false;
+        size_t plane = (size_t)header.rows * header.cols;
+        cost = reinterpret_cast<int32_t*>(static_cast<char*>(base) + sizeof(TileHeader));
+        via = reinterpret_cast<uint8_t*>(cost + plane * header.layers);
+        taken = via + plane;
+        return true;
+    }
+
+    TileRouter router() const {
+        return {{header.layers, header.rows, header.cols, cost},
+                {via, header.cols, VIA_COST},
+                {TURN_PENALTY}};
+    }
+    tuple<int, int, int> local(tuple<int, int, int> cell) const {
+        auto [x, y, l] = cell;
+        return {x - header.x0, y - header.y0, l};
+    }
+    tuple<int, int, int> die(tuple<int, int, int> cell) const {
+        auto [x, y, l] = cell;
+        return {x + header.x0, y + header.y0, l};
+    }
+};
+
+// Tiles mapped by this process; cleared once a tile is done so resident
+// pages stay within a few windows.
+struct TileCache {
+    const TileLayout& layout;
+    map<int, unique_ptr<TileView>> views;
+
+    explicit TileCache(const TileLayout& _layout) : layout(_layout) {}
+
+    TileView* get(int t) {
+        auto& view = views[t];
+        if (!view) {
+            view = make_unique<TileView>();
+            if (!view->open(layout, t)) {
+                views.erase(t);
+                return nullptr;
+            }
+        }
+        return view.get();
+    }
+    void clear() { views.clear(); }
+
+    // Sets the taken flag of die cell (x, y, l) in every window holding it.
+    bool mark(tuple<int, int, int> cell, uint8_t value) {
+        auto [x, y, l] = cell;
+        int h = layout.halo, s = layout.size;
+        for (int i = max(x - h, 0) / s; i <= min(x + h, layout.rows - 1) / s; ++i) {
+            for (int j = max(y - h, 0) / s; j <= min(y + h, layout.cols - 1) / s; ++j) {
+                TileView* view = get(i * layout.tileCols + j);
+                if (!view) return false;
+                const TileHeader& w = view->header;
+                view->taken[((size_t)l * w.rows + (x - w.x0)) * w.cols + (y - w.y0)] = value;
+            }
+        }
+        return true;
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Routing
+// ---------------------------------------------------------------------------
+
+// State shared by the coordinator and its forked workers.
+struct SharedState {
+    atomic<int> nextTile;
+    atomic<long long> peakKb;   // largest worker RSS
+};
+
+template <class T>
+T* sharedArray(size_t n) {
+    void* p = mmap(nullptr, max(sizeof(T) * n, (size_t)1), PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    return p == MAP_FAILED ? nullptr : static_cast<T*>(p);
+}
+
+long long peakRssKb() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+void recordPeak(SharedState& shared) {
+    long long kb = peakRssKb(), seen = shared.peakKb.load();
+    while (kb > seen && !shared.peakKb.compare_exchange_weak(seen, kb)) {}
+}
+
+// Runs body() in count forked processes and waits for them; false if any
+// of them fails.
+bool runProcesses(int count, const function<bool()>& body) {
+    cout.flush();
+    vector<pid_t> children;
+    for (int w = 0; w < count; ++w) {
+        pid_t pid = fork();
+        if (pid == 0) _exit(body() ? 0 : 1);
+        if (pid < 0) break;
+        children.push_back(pid);
+    }
+    bool ok = (int)children.size() == count;
+    for (pid_t pid : children) {
+        int status;
+        ok = waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0 && ok;
+    }
+    return ok;
+}
+
+void writeRoute(ostream& out, int k, int cost, const Path& path) {
+    out << "NET " << k << " " << cost;
+    for (auto [x, y, l] : path) out << " " << x << " " << y << " " << l;
+    out << "\n";
+}
+
+// Routes a net whose pins lie in different tiles one tile at a time and
+// claims its cells as it goes. Returns the cost, or -1 (releasing every cell)
+// if some tile offers no way on or the route keeps wandering.
+int stitchNet(const TileLayout& layout, TileCache& tiles, SourceTree& tree,
+              const SearchOptions& options, const Net& net, Path& path) {
+    auto target = net.target;
+    auto [tx, ty, tl] = target;
+    auto [sx, sy, sl] = net.start;
+    int segments = 2 * (abs(tx / layout.size - sx / layout.size) +
+                        abs(ty / layout.size - sy / layout.size)) + 8;
+    auto cur = net.start;
+    int cost = 0;
+    path.clear();
+
+    for (int segment = 0; segment < segments; ++segment) {
+        auto [cx, cy, cl] = cur;
+        int t = layout.owner(cx, cy);
+        TileView* view = tiles.get(t);
+        if (!view) break;
+        TileRouter router = view->router();
+        Rect core = layout.core(t), w = layout.window(t);
+        int rows = w.x2 - w.x1 + 1, cols = w.y2 - w.y1 + 1;
+
+        // Exits: the target if the window holds it, else the window edges
+        // facing it; every inner window edge if none of those is reachable.
+        auto edges = [&](bool up, bool down, bool left, bool right) {
+            vector<tuple<int, int, int>> cells;
+            for (int l = 0; l < layout.layers; ++l) {
+                for (int y = 0; y < cols; ++y) {
+                    if (up && w.x1 > 0) cells.push_back({0, y, l});
+                    if (down && w.x2 < layout.rows - 1) cells.push_back({rows - 1, y, l});
+                }
+                for (int x = 0; x < rows; ++x) {
+                    if (left && w.y1 > 0) cells.push_back({x, 0, l});
+                    if (right && w.y2 < layout.cols - 1) cells.push_back({x, cols - 1, l});
+                }
+            }
+            return cells;
+        };
+        auto score = [&](tuple<int, int, int> cell) {
+            auto [lx, ly, l] = cell;
+            auto [x, y, dl] = view->die(cell);
+            long long d = tree.scratch.cellDistance(router.grid.index(lx, ly, l));
+            if (d == INF) return (long long)INF;
+            return d + (long long)layout.minCost * (abs(x - tx) + abs(y - ty)) + VIA_COST * abs(l - tl);
+        };
+        auto pick = [&](const vector<tuple<int, int, int>>& exits) {
+            router.settleTargets(tree, exits);
+            long long best = INF;
+            tuple<int, int, int> choice{-1, -1, -1};
+            for (auto cell : exits) {
+                long long s = score(cell);
+                if (s < best) best = s, choice = cell;
+            }
+            return choice;
+        };
+
+        router.plantTree(tree, view->taken, view->local(cur), options);
+        bool holdsTarget = contains(w, tx, ty);
+        auto goal = holdsTarget ? pick({view->local(target)})
+                                : pick(edges(tx < w.x1, tx > w.x2, ty < w.y1, ty > w.y2));
+        if (get<0>(goal) < 0) goal = pick(edges(true, true, true, true));
+        if (get<0>(goal) < 0) break;
+
+        Path branch = router.treePath(tree, goal);
+        bool arrived = holdsTarget && goal == view->local(target);
+        size_t keep = branch.size();
+        if (!arrived) {
+            for (keep = 0; keep < branch.size(); ++keep) {
+                auto [x, y, l] = view->die(branch[keep]);
+                if (!contains(core, x, y)) break;
+            }
+        }
+        Path kept(branch.begin(), branch.begin() + keep);
+        cost += router.computeTotalCost(kept);
+        for (auto cell : kept) {
+            path.push_back(view->die(cell));
+            if (!tiles.mark(path.back(), 1)) return -1;
+        }
+        if (arrived) {
+            tiles.clear();
+            return cost;
+        }
+        cur = view->die(branch[keep]);   // first cell in the next tile
+        tiles.clear();
+    }
+
+    for (auto cell : path) tiles.mark(cell, 0);
+    tiles.clear();
+    path.clear();
+    return -1;
+}
+
+bool routeCrossNets(const TileLayout& layout, const vector<Net>& nets, const vector<int>& crossing,
+                    const SearchOptions& options, int32_t* costs, SharedState& shared) {
+    TileCache tiles(layout);
+    SourceTree tree;
+    ofstream out(layout.dir + "/cross.routes");
+    Path path;
+    for (int k : crossing) {
+        costs[k] = stitchNet(layout, tiles, tree, options, nets[k], path);
+        writeRoute(out, k, costs[k], path);
+    }
+    recordPeak(shared);
+    return (bool)out;
+}
+
+// Worker: takes tiles of the current phase off the shared counter and routes
+// their nets inside the tile window.
+bool routeTileNets(const TileLayout& layout, const vector<Net>& nets, const vector<vector<int>>& netsOf,
+                   const vector<int>& tiles, const SearchOptions& baseOptions, int32_t* costs,
+                   SharedState& shared) {
+    TileCache cache(layout);
+    SearchScratch scratch;
+    SearchOptions options = baseOptions;
+    options.scratch = &scratch;
+    bool ok = true;
+    for (int k = shared.nextTile++; ok && k < (int)tiles.size(); k = shared.nextTile++) {
+        int t = tiles[k];
+        TileView* view = cache.get(t);
+        if (!view) return false;
+        TileRouter router = view->router();
+        ofstream out(layout.name(t) + ".routes");
+        for (int n : netsOf[t]) {
+            Path path = router.dijkstra3D(view->taken, view->local(nets[n].start),
+                                          view->local(nets[n].target), options);
+            costs[n] = path.empty() ? -1 : router.computeTotalCost(path);
+            for (auto& cell : path) {
+                cell = view->die(cell);
+                ok = cache.mark(cell, 1) && ok;
+            }
+            writeRoute(out, n, costs[n], path);
+        }
+        ok = ok && (bool)out;
+        cache.clear();
+    }
+    recordPeak(shared);
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+
+// Deterministic synthetic die: costs 1..5 and a via at about one (x, y) in 8.
+uint32_t cellHash(uint32_t seed, uint32_t a, uint32_t b, uint32_t c) {
+    uint64_t h = seed * 0x9E3779B97F4A7C15ull ^ a * 0xC2B2AE3D27D4EB4Full ^
+                 b * 0x165667B19E3779F9ull ^ c * 0x27D4EB2F165667C5ull;
+    h ^= h >> 31; h *= 0x7FB5D329728EA185ull; h ^= h >> 27;
+    return (uint32_t)(h >> 32);
+}
+
+int main(int argc, char* argv[]) {
+    string dir, gridFile, routesFile;
+    int layers = 3, rows = 512, cols = 512, size = 256, halo = 16;
+    int workers = max(1, (int)sysconf(_SC_NPROCESSORS_ONLN));
+    unsigned seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        string flag = argv[i];
+        if (flag == "--tiles" && i + 1 < argc) dir = argv[++i];
+        else if (flag == "--grid" && i + 1 < argc) gridFile = argv[++i];
+        else if (flag == "--die" && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%dx%d", &layers, &rows, &cols) != 3) {
+                cerr << "--die expects LAYERSxROWSxCOLS\n";
+                return 1;
+            }
+        }
+        else if (flag == "--seed" && i + 1 < argc) seed = stoul(argv[++i]);
+        else if (flag == "--tile" && i + 1 < argc) size = stoi(argv[++i]);
+        else if (flag == "--halo" && i + 1 < argc) halo = stoi(argv[++i]);
+        else if (flag == "--workers" && i + 1 < argc) workers = max(1, stoi(argv[++i]));
+        else if (flag == "--routes" && i + 1 < argc) routesFile = argv[++i];
+    }
+    if (dir.empty()) {
+        cerr << "Usage: RouterTiled --tiles DIR [--grid FILE | --die LxRxC --seed S] [--tile N] "
+                "[--halo H] [--workers N] [--routes FILE] < nets\n";
+        return 1;
+    }
+    if (halo < 1 || halo * 2 > size) {
+        cerr << "Need 1 <= --halo <= tile / 2\n";
+        return 1;
+    }
+    mkdir(dir.c_str(), 0755);
+
+    auto begin = chrono::steady_clock::now();
+    function<bool(int, int, vector<int32_t>&)> costRow;
+    function<bool(int, vector<uint8_t>&)> viaRow;
+    ifstream grid;
+    if (!gridFile.empty()) {
+        grid.open(gridFile);
+        if (!(grid >> layers >> rows >> cols)) {
+            cerr << "Could not read grid from " << gridFile << "\n";
+            return 1;
+        }
+        costRow = [&](int, int, vector<int32_t>& out) {
+            for (auto& c : out)
+                if (!(grid >> c)) return false;
+            return true;
+        };
+        viaRow = [&](int, vector<uint8_t>& out) {
+            for (auto& v : out) {
+                int flag;
+                if (!(grid >> flag)) return false;
+                v = flag != 0;
+            }
+            return true;
+        };
+    } else {
+        costRow = [&](int l, int x, vector<int32_t>& out) {
+            for (int y = 0; y < cols; ++y) out[y] = 1 + cellHash(seed, l, x, y) % 5;
+            return true;
+        };
+        viaRow = [&](int x, vector<uint8_t>& out) {
+            for (int y = 0; y < cols; ++y) out[y] = cellHash(seed, x, y, 0xFFFFFFFF) % 8 == 0;
+            return true;
+        };
+    }
+    if (layers <= 0 || rows <= 0 || cols <= 0) {
+        cerr << "Invalid die size\n";
+        return 1;
+    }
+
+    TileLayout layout(layers, rows, cols, size, halo, dir);
+    if (!buildTiles(layout, costRow, viaRow)) {
+        cerr << "Could not write tiles to " << dir << "\n";
+        return 1;
+    }
+    grid.close();
+    double buildSeconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    int n;
+    vector<Net> nets;
+    if (cin >> n) {
+        for (int i = 0; i < n; ++i) {
+            int x1, y1, l1, x2, y2, l2;
+            if (!(cin >> x1 >> y1 >> l1 >> x2 >> y2 >> l2) ||
+                !isValid(x1, y1, rows, cols) || !isValid(x2, y2, rows, cols) ||
+                l1 < 0 || l2 < 0 || l1 >= layers || l2 >= layers) {
+                cerr << "Net " << i << " is malformed or out of the die\n";
+                return 1;
+            }
+            nets.push_back({"Net" + to_string(i + 1), {x1, y1, l1}, {x2, y2, l2}});
+        }
+    }
+
+    vector<int> crossing;
+    vector<vector<int>> netsOf(layout.count());
+    vector<vector<int>> phaseTiles(4);
+    for (int k = 0; k < (int)nets.size(); ++k) {
+        auto [sx, sy, sl] = nets[k].start;
+        auto [tx, ty, tl] = nets[k].target;
+        int t = layout.owner(sx, sy);
+        if (t != layout.owner(tx, ty)) crossing.push_back(k);
+        else {
+            if (netsOf[t].empty()) phaseTiles[layout.phase(t)].push_back(t);
+            netsOf[t].push_back(k);
+        }
+    }
+    for (int t = 0; t < layout.count(); ++t) unlink((layout.name(t) + ".routes").c_str());
+
+    SearchOptions options;
+    SharedState* shared = sharedArray<SharedState>(1);
+    int32_t* costs = sharedArray<int32_t>(nets.size());
+    if (!shared || !costs) {
+        cerr << "Could not map shared memory\n";
+        return 1;
+    }
+    new (shared) SharedState{};
+    fill(costs, costs + nets.size(), -1);
+
+    bool ok = runProcesses(1, [&] {
+        return routeCrossNets(layout, nets, crossing, options, costs, *shared);
+    });
+    for (int p = 0; ok && p < 4; ++p) {
+        shared->nextTile = 0;
+        int pool = min(workers, (int)phaseTiles[p].size());
+        ok = runProcesses(pool, [&] {
+            return routeTileNets(layout, nets, netsOf, phaseTiles[p], options, costs, *shared);
+        });
+    }
+    if (!ok) {
+        cerr << "A routing process failed (tile files in " << dir << ")\n";
+        return 1;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    if (!routesFile.empty()) {
+        ofstream out(routesFile);
+        auto append = [&](const string& path) {
+            ifstream in(path);
+            if (in.peek() != EOF) out << in.rdbuf();   // an empty copy would fail the stream
+        };
+        append(dir + "/cross.routes");
+        for (int t = 0; t < layout.count(); ++t)
+            if (!netsOf[t].empty()) append(layout.name(t) + ".routes");
+    }
+
+    int routed = 0;
+    long long totalCost = 0;
+    for (size_t k = 0; k < nets.size(); ++k) {
+        if (costs[k] < 0) continue;
+        routed++;
+        totalCost += costs[k];
+    }
+    cout << "Die " << layers << "x" << rows << "x" << cols << " in " << layout.count() << " tiles of "
+         << size << " (+" << halo << " halo), built in " << buildSeconds << " s\n";
+    cout << "Routed " << routed << "/" << nets.size() << " nets (" << crossing.size()
+         << " crossing tiles), total cost " << totalCost << ", " << seconds << " s\n";
+    cout << "Peak RSS: coordinator " << peakRssKb() << " KB, largest worker "
+         << shared->peakKb.load() << " KB\n";
+    return 0;
+}
@@ -1,113 +1,6 @@
-#include <iostream>
-#include <vector>
-#include <queue>
-#include <climits>
-#include <tuple>
-#include <algorithm>
-#include <string>
-using namespace std;
-
-const int INF = INT_MAX;
-const string SYMBOLS = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
-
-struct Node {
-    int x, y, layer, cost;
-    Node(int _x, int _y, int _layer, int _cost)
-        : x(_x), y(_y), layer(_layer), cost(_cost) {}
-    bool operator>(const Node& other) const {
-        return cost > other.cost;
-    }
-};
-
-struct Net {
-    string name;
-    tuple<int, int, int> start;
-    tuple<int, int, int> target;
-};
-
-bool isValid(int x, int y, int rows, int cols) {
-    return x >= 0 && y >= 0 && x < rows && y < cols;
-}
-
-vector<tuple<int, int, int>> dijkstra3D(
-    const vector<vector<vector<int>>>& grid,
-    const vector<vector<vector<bool>>>& blocked,
-    tuple<int, int, int> start,
-    tuple<int, int, int> target
-) {
-    int layers = grid.size(), rows = grid[0].size(), cols = grid[0][0].size();
-
-    vector<vector<vector<int>>> dist(layers, vector<vector<int>>(rows, vector<int>(cols, INF)));
-    vector<vector<vector<tuple<int, int, int>>>> parent(layers, vector<vector<tuple<int, int, int>>>(rows, vector<tuple<int, int, int>>(cols, {-1, -1, -1})));
-
-    auto [sx, sy, sl] = start;
-    auto [tx, ty, tl] = target;
-
-    if (blocked[sl][sx][sy] || blocked[tl][tx][ty])
-        return {};
-
-    dist[sl][sx][sy] = grid[sl][sx][sy];
-    priority_queue<Node, vector<Node>, greater<Node>> pq;
-    pq.push(Node(sx, sy, sl, grid[sl][sx][sy]));
-
-    vector<pair<int, int>> directions = {{0,1},{1,0},{-1,0},{0,-1}};
-
-    while (!pq.empty()) {
-        Node current = pq.top(); pq.pop();
-        int x = current.x, y = current.y, l = current.layer;
-
-        if (make_tuple(x, y, l) == target) break;
-
-        for (auto dir : directions) {
-            int nx = x + dir.first, ny = y + dir.second;
-            if (isValid(nx, ny, rows, cols) && !blocked[l][nx][ny]) {
-                int newCost = dist[l][x][y] + grid[l][nx][ny];
-                if (newCost < dist[l][nx][ny]) {
-                    dist[l][nx][ny] = newCost;
-                    parent[l][nx][ny] = {x, y, l};
-                    pq.push(Node(nx, ny, l, newCost));
-                }
-            }
-        }
-    
-    }
-
-    vector<tuple<int, int, int>> path;
-    if (dist[tl][tx][ty] == INF) return {};
+#include "RouterCore.h"
 
-    tuple<int, int, int> p = target;
-    while (p != make_tuple(-1, -1, -1)) {
-        path.push_back(p);
-        p = parent[get<2>(p)][get<0>(p)][get<1>(p)];
-    }
-    reverse(path.begin(), path.end());
-    return path;
-}
-
-int computeTotalCost(const vector<tuple<int, int, int>>& path,
-                     const vector<vector<vector<int>>>& grid) {
-    int totalCost = 0;
-    for (size_t i = 0; i < path.size(); ++i) {
-        auto [x, y, l] = path[i];
-        totalCost += grid[l][x][y];
-        if (i > 0) {
-            auto [px, py, pl] = path[i - 1];
-        }
-    }
-    return totalCost;
-}
-
-void printGridLayers(const vector<vector<vector<char>>>& layout, int layers) {
-    for (int l = 0; l < layers; ++l) {
-        cout << "\nLayer " << l << ":\n";
-        for (int i = 0; i < layout[0].size(); ++i) {
-            for (int j = 0; j < layout[0][0].size(); ++j) {
-                cout << layout[l][i][j] << " ";
-            }
-            cout << "\n";
-        }
-    }
-}
+using GridRouter = Router<SingleLayer, NoVias, NoTurnPenalty>;
 
 int main() {
     int rows = 8, cols = 8, layers = 1;
@@ -127,7 +20,10 @@ int main() {
 
 
 
-    vector<vector<vector<bool>>> blocked(layers, vector<vector<bool>>(rows, vector<bool>(cols, false)));
+    vector<int32_t> costs = flattenLayers(grid);
+    GridRouter router{{layers, rows, cols, costs.data()}, {}, {}};
+
+    vector<uint8_t> blocked(router.grid.size(), 0);
     vector<vector<vector<char>>> layout(layers, vector<vector<char>>(rows, vector<char>(cols, '.')));
 
     int n;
@@ -161,19 +57,19 @@ int main() {
         char symbol = (i < SYMBOLS.size()) ? SYMBOLS[i] : '*';
         cout << "\nRouting " << net.name << "...\n";
 
-        auto path = dijkstra3D(grid, blocked, net.start, net.target);
+        auto path = router.dijkstra3D(blocked.data(), net.start, net.target);
 
         if (path.empty()) {
             cout << "No path found for " << net.name << "!\n";
             continue;
         }
 
-        int cost = computeTotalCost(path, grid);
+        int cost = router.computeTotalCost(path);
         totalRoutingCost += cost;
 
         cout << net.name << " routed with cost " << cost << ":\n";
         for (auto [x, y, l] : path) {
-            blocked[l][x][y] = true;
+            blocked[router.grid.index(x, y, l)] = 1;
             layout[l][x][y] = symbol;
             cout << "(" << x << "," << y << ") [L" << l << "] -> ";
         }